@@ -0,0 +1,318 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file columnar.hpp
+ * @brief Implementation of a streaming binary columnar store of aggregated rows, replayable into plots.
+ */
+
+#ifndef FCPP_COLUMNAR_H_
+#define FCPP_COLUMNAR_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lib/fcpp.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Reader of a columnar file, memory-mapped where supported.
+ *
+ * The file starts with the magic `FCPPCOL1`, the number of columns and the
+ * name of the row type (as uint64 length and characters, padded to 8 bytes).
+ * Blocks follow, each made of its number of rows (uint64) and the values of
+ * every column for those rows in sequence (float64), in native byte order.
+ */
+class columnar_reader {
+  public:
+    //! @brief Constructor given the file name (empty if it cannot be read).
+    columnar_reader(std::string const& file) {
+#ifndef _WIN32
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 and st.st_size > 0) {
+            void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                m_data = static_cast<char const*>(m);
+                m_size = st.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::FILE* f = std::fopen(file.c_str(), "rb");
+        if (f == nullptr) return;
+        char buf[4096];
+        for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;)
+            m_buffer.insert(m_buffer.end(), buf, buf + n);
+        std::fclose(f);
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+        parse();
+    }
+
+    //! @brief Copies are not allowed.
+    columnar_reader(columnar_reader const&) = delete;
+
+    //! @brief Destructor (unmapping the file).
+    ~columnar_reader() {
+#ifndef _WIN32
+        if (m_data != nullptr)
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    //! @brief Whether the file was read and is well-formed.
+    bool valid() const {
+        return m_valid;
+    }
+
+    //! @brief The name of the row type.
+    std::string const& row_type() const {
+        return m_type;
+    }
+
+    //! @brief The number of columns.
+    size_t columns() const {
+        return m_columns;
+    }
+
+    //! @brief The number of rows.
+    size_t rows() const {
+        return m_rows;
+    }
+
+    //! @brief Calls a function on the values of every row, in order.
+    template <typename F>
+    void for_each(F&& f) const {
+        std::vector<double> row(m_columns);
+        for (size_t b : m_blocks) {
+            uint64_t n = read(b);
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = 0; j < m_columns; ++j)
+                    row[j] = value(b + sizeof(uint64_t) + (j * n + i) * sizeof(double));
+                f(row.data());
+            }
+        }
+    }
+
+  private:
+    //! @brief Reads a word at an offset.
+    uint64_t read(size_t offset) const {
+        uint64_t x;
+        std::memcpy(&x, m_data + offset, sizeof(x));
+        return x;
+    }
+
+    //! @brief Reads a value at an offset.
+    double value(size_t offset) const {
+        double x;
+        std::memcpy(&x, m_data + offset, sizeof(x));
+        return x;
+    }
+
+    //! @brief Parses the header and locates the blocks (ignoring a truncated last block).
+    void parse() {
+        if (m_size < 24 or std::memcmp(m_data, "FCPPCOL1", 8) != 0) return;
+        m_columns = read(8);
+        uint64_t len = read(16);
+        size_t offset = 24 + (len + 7) / 8 * 8;
+        if (offset > m_size) return;
+        m_type.assign(m_data + 24, len);
+        while (offset + sizeof(uint64_t) <= m_size) {
+            uint64_t n = read(offset);
+            size_t next = offset + sizeof(uint64_t) + n * m_columns * sizeof(double);
+            if (next > m_size) break;
+            m_blocks.push_back(offset);
+            m_rows += n;
+            offset = next;
+        }
+        m_valid = true;
+    }
+
+    //! @brief The content of the file.
+    char const* m_data = nullptr;
+    //! @brief The size of the file.
+    size_t m_size = 0;
+#ifdef _WIN32
+    //! @brief The content of the file (where it cannot be mapped).
+    std::vector<char> m_buffer;
+#endif
+    //! @brief Whether the file is well-formed.
+    bool m_valid = false;
+    //! @brief The name of the row type.
+    std::string m_type;
+    //! @brief The number of columns.
+    size_t m_columns = 0;
+    //! @brief The number of rows.
+    size_t m_rows = 0;
+    //! @brief The offsets of the blocks.
+    std::vector<size_t> m_blocks;
+};
+
+
+/**
+ * @brief Plotter streaming rows to a columnar file, from which a plotter of type P is built later.
+ *
+ * Rows are buffered in blocks of a fixed number of rows, and written to the file
+ * column by column whenever a block is full, so that memory stays constant in
+ * the length of the run. A file holds rows of a single type, fixed by its first
+ * row. Every row type received is registered at startup under its `typeid` name,
+ * so that the file can be replayed by runs of the same executable: as that name
+ * depends on the compiler, executables built otherwise may not recognise it.
+ */
+template <typename P>
+class columnar_plotter {
+  public:
+    //! @brief The number of rows in a block.
+    static constexpr size_t block_size = 256;
+
+    //! @brief Constructor given the file name (truncated).
+    columnar_plotter(std::string const& file) : m_file(std::fopen(file.c_str(), "wb")) {}
+
+    //! @brief Copies are not allowed.
+    columnar_plotter(columnar_plotter const&) = delete;
+
+    //! @brief Destructor (flushing the last block).
+    ~columnar_plotter() {
+        flush();
+        if (m_file != nullptr) std::fclose(m_file);
+    }
+
+    //! @brief Appends a row (throwing std::invalid_argument if its type differs from that of the first row).
+    template <typename R>
+    columnar_plotter& operator<<(R const& row) {
+        (void)registrar<R>::done;
+        std::lock_guard<std::mutex> l(m_lock);
+        if (m_type == nullptr) header<R>(typename R::tags{});
+        else if (*m_type != typeid(R))
+            throw std::invalid_argument(std::string("columnar row of type ") + typeid(R).name() + " after rows of type " + m_type->name());
+        push(row, typename R::tags{});
+        if (++m_rows == block_size) write();
+        return *this;
+    }
+
+    //! @brief Writes the rows buffered so far.
+    void flush() {
+        std::lock_guard<std::mutex> l(m_lock);
+        if (m_rows > 0) write();
+        if (m_file != nullptr) std::fflush(m_file);
+    }
+
+    //! @brief Feeds the rows of a columnar file to a plotter, returning whether its row type is known.
+    static bool replay(std::string const& file, P& p) {
+        columnar_reader r(file);
+        if (not r.valid()) return false;
+        auto it = replayers().find(r.row_type());
+        if (it == replayers().end()) return false;
+        it->second(r, p);
+        return true;
+    }
+
+  private:
+    //! @brief Type of functions feeding the rows of a file to a plotter.
+    using replayer_t = void(*)(columnar_reader const&, P&);
+
+    //! @brief Replay functions by row type.
+    static std::unordered_map<std::string, replayer_t>& replayers() {
+        static std::unordered_map<std::string, replayer_t> m;
+        return m;
+    }
+
+    //! @brief Registers the replay function of a row type, at startup.
+    template <typename R>
+    struct registrar {
+        //! @brief Whether the registration happened.
+        static bool const done;
+    };
+
+    //! @brief Feeds the rows of a file to a plotter, as rows of type R.
+    template <typename R, typename... Ss>
+    static void replay_rows(columnar_reader const& r, P& p, common::type_sequence<Ss...>) {
+        if (r.columns() != sizeof...(Ss)) return;
+        r.for_each([&](double const* v) {
+            R row;
+            size_t i = 0;
+            int dummy[] = {0, (common::get<Ss>(row) = static_cast<std::decay_t<decltype(common::get<Ss>(row))>>(v[i++]), 0)...};
+            (void)dummy;
+            p << row;
+        });
+    }
+
+    //! @brief Writes the file header.
+    template <typename R, typename... Ss>
+    void header(common::type_sequence<Ss...>) {
+        m_type = &typeid(R);
+        m_columns = sizeof...(Ss);
+        m_buffer.resize(m_columns * block_size);
+        if (m_file == nullptr) return;
+        std::string type = typeid(R).name();
+        uint64_t h[] = {m_columns, type.size()};
+        std::fwrite("FCPPCOL1", 1, 8, m_file);
+        std::fwrite(h, sizeof(uint64_t), 2, m_file);
+        std::fwrite(type.data(), 1, type.size(), m_file);
+        std::fwrite("\0\0\0\0\0\0\0", 1, (8 - type.size() % 8) % 8, m_file);
+    }
+
+    //! @brief Buffers the values of a row.
+    template <typename R, typename... Ss>
+    void push(R const& row, common::type_sequence<Ss...>) {
+        size_t j = 0;
+        int dummy[] = {0, (m_buffer[(j++) * block_size + m_rows] = double(common::get<Ss>(row)), 0)...};
+        (void)dummy;
+    }
+
+    //! @brief Writes the buffered block.
+    void write() {
+        if (m_file != nullptr) {
+            uint64_t n = m_rows;
+            std::fwrite(&n, sizeof(n), 1, m_file);
+            for (size_t j = 0; j < m_columns; ++j)
+                std::fwrite(m_buffer.data() + j * block_size, sizeof(double), m_rows, m_file);
+        }
+        m_rows = 0;
+    }
+
+    //! @brief Lock guarding the buffer and file.
+    std::mutex m_lock;
+    //! @brief The file.
+    std::FILE* m_file;
+    //! @brief The type of the rows (null before the first row).
+    std::type_info const* m_type = nullptr;
+    //! @brief The number of columns.
+    size_t m_columns = 0;
+    //! @brief The number of rows buffered.
+    size_t m_rows = 0;
+    //! @brief The values buffered, column by column.
+    std::vector<double> m_buffer;
+};
+
+template <typename P>
+template <typename R>
+bool const columnar_plotter<P>::registrar<R>::done = (columnar_plotter<P>::replayers()[typeid(R).name()] = [](columnar_reader const& r, P& p) {
+    columnar_plotter<P>::template replay_rows<R>(r, p, typename R::tags{});
+}, true);
+
+}
+
+#endif // FCPP_COLUMNAR_H_
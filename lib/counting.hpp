@@ -0,0 +1,120 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file counting.hpp
+ * @brief Implementation of fused counting and boolean reduction operators over neighbourhoods.
+ */
+
+#ifndef FCPP_COUNTING_H_
+#define FCPP_COUNTING_H_
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lib/beautify.hpp"
+#include "lib/data/field.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Namespace of implementation details.
+namespace details {
+    /**
+     * @brief Reads the values of a field for devices in increasing identifier order, with no intermediate fields.
+     *
+     * Devices not in the field get its default value. Reading a whole domain in
+     * order takes linear time overall, so that several fields can be combined in
+     * a single loop instead of building temporary fields through `mux` or `map_hood`.
+     */
+    template <typename T>
+    class field_cursor {
+      public:
+        //! @brief Constructor given the field (which should outlive the cursor).
+        field_cursor(field<T> const& f) : m_ids(fcpp::details::get_ids(f)), m_vals(fcpp::details::get_vals(f)) {}
+
+        //! @brief The value for a device, not lower than the devices previously read.
+        decltype(auto) operator()(device_t d) {
+            while (m_next < m_ids.size() and m_ids[m_next] < d) ++m_next;
+            return m_next < m_ids.size() and m_ids[m_next] == d ? m_vals[m_next+1] : m_vals[0];
+        }
+
+      private:
+        //! @brief The identifiers of the devices in the field.
+        std::vector<device_t> const& m_ids;
+        //! @brief The default value followed by the values of the devices.
+        std::decay_t<decltype(fcpp::details::get_vals(std::declval<field<T> const&>()))> const& m_vals;
+        //! @brief The position of the next device.
+        size_t m_next = 0;
+    };
+
+    /**
+     * @brief Counts the values of a field satisfying a predicate, with no intermediate fields.
+     *
+     * Only the devices aligned with the field are considered, together with the
+     * current device (with the default value of the field, if not aligned).
+     * Values are scanned contiguously in a loop without branches, which compilers vectorise.
+     */
+    template <typename T, typename P>
+    int count_if(field<T> const& f, device_t self, P&& pred) {
+        std::vector<device_t> const& ids = fcpp::details::get_ids(f);
+        auto const& vals = fcpp::details::get_vals(f);
+        int c = 0;
+        for (size_t i = 1; i < vals.size(); ++i)
+            c += pred(vals[i]) ? 1 : 0;
+        if (not std::binary_search(ids.begin(), ids.end(), self))
+            c += pred(vals[0]) ? 1 : 0;
+        return c;
+    }
+
+    /**
+     * @brief Whether a boolean field holds a given value in some device aligned with it.
+     *
+     * The current device is also considered (with the default value of the field, if not aligned).
+     */
+    inline bool contains(field<bool> const& f, device_t self, bool v) {
+        std::vector<device_t> const& ids = fcpp::details::get_ids(f);
+        auto const& vals = fcpp::details::get_vals(f);
+        if (std::find(vals.begin() + 1, vals.end(), v) != vals.end())
+            return true;
+        return vals[0] == v and not std::binary_search(ids.begin(), ids.end(), self);
+    }
+}
+
+//! @brief Counts the neighbours within a given distance, including the current device.
+FUN int count_within(ARGS, real_t radius) { CODE
+    field<real_t> const& d = node.nbr_dist();
+    return details::count_if(d, node.uid, [radius](real_t x) {
+        return x < radius;
+    });
+}
+
+//! @brief Counts the devices aligned with a field where it is true, including the current one.
+FUN int count_where(ARGS, field<bool> const& f) { CODE
+    return details::count_if(f, node.uid, [](bool x) {
+        return x;
+    });
+}
+
+//! @brief Whether a field is true in all devices aligned with it, including the current one (as `all_hood`).
+FUN bool all_true(ARGS, field<bool> const& f) { CODE
+    return not details::contains(f, node.uid, false);
+}
+
+//! @brief Whether a field is true in some device aligned with it, including the current one (as `any_hood`).
+FUN bool any_true(ARGS, field<bool> const& f) { CODE
+    return details::contains(f, node.uid, true);
+}
+
+}
+
+}
+
+#endif // FCPP_COUNTING_H_
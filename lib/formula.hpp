@@ -0,0 +1,611 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file formula.hpp
+ * @brief Implementation of compile-time formulas over Past-CTL and SLCS logic operators.
+ */
+
+#ifndef FCPP_FORMULA_H_
+#define FCPP_FORMULA_H_
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "lib/beautify.hpp"
+#include "lib/past_ctl.hpp"
+#include "lib/slcs.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+/**
+ * @brief Namespace of formulas built as types, evaluated by a single fused function.
+ *
+ * Formulas are built from propositions `prop<i>` (the i-th argument given to `evaluate`)
+ * and constants through `!`, `&`, `|`, `<=` (implication) and the logic operators below.
+ * Redundancies are folded while building (double negations, constants, idempotent
+ * operators, repeated or complementary arguments), derived operators are expanded into
+ * their definitions, and every distinct subformula is evaluated once per round, e.g.:
+ *
+ *     constexpr auto alert_end = formula::Y(formula::prop<0>{}) & !formula::prop<0>{};
+ *     bool r = formula::evaluate(CALL, alert_end, cluster);
+ *     FUN_EXPORT alert_end_t = export_list<formula::exports<decltype(alert_end)>>;
+ *
+ * Several monitors can be evaluated together, sharing their common subformulas,
+ * returning their values and storing those of named monitors under their tags:
+ *
+ *     constexpr auto monitors = std::make_tuple(formula::monitor<tags::alert_end>(alert_end), ...);
+ *     std::array<bool, n> r = formula::evaluate(CALL, monitors, cluster);
+ */
+namespace formula {
+
+//! @brief Base of every formula type.
+struct expr {};
+
+//! @brief The i-th proposition given to the evaluation.
+template <size_t i>
+struct prop : expr {};
+
+//! @brief A constant truth value.
+template <bool b>
+struct constant : expr {};
+
+//! @brief The true constant.
+using top = constant<true>;
+
+//! @brief The false constant.
+using bottom = constant<false>;
+
+//! @brief A formula whose value is kept in the node storage, under a tag S.
+template <typename S, typename E>
+struct named_monitor {};
+
+//! @brief Negation of a formula.
+template <typename F>
+struct not_t : expr {};
+
+//! @brief Conjunction of formulas.
+template <typename F, typename G>
+struct and_t : expr {};
+
+//! @brief Disjunction of formulas.
+template <typename F, typename G>
+struct or_t : expr {};
+
+//! @brief Application of a logic operator to formulas.
+template <typename O, typename... Fs>
+struct op_t : expr {};
+
+//! @brief Logic operators that can be applied in formulas, with the exports they need.
+namespace ops {
+    //! @brief Declares an operator calling a logic function with given arguments and exports.
+    #define FCPP_FORMULA_OP(name, exp, args, vals)                      \
+    struct name {                                                       \
+        using exports = exp;                                            \
+        FUN static bool apply(ARGS, FCPP_FORMULA_UNPACK args) { CODE    \
+            return logic::name(CALL, FCPP_FORMULA_UNPACK vals);         \
+        }                                                               \
+    }
+    //! @brief Declares a time-bounded operator calling a logic function with given arguments.
+    #define FCPP_FORMULA_BOUNDED_OP(name, args, vals)                   \
+    template <intmax_t t>                                               \
+    struct name {                                                       \
+        using exports = export_list<times_t>;                           \
+        FUN static bool apply(ARGS, FCPP_FORMULA_UNPACK args) { CODE    \
+            return logic::name(CALL, FCPP_FORMULA_UNPACK vals, t);      \
+        }                                                               \
+    }
+    //! @brief Removes the parentheses around a list.
+    #define FCPP_FORMULA_UNPACK(...) __VA_ARGS__
+
+    FCPP_FORMULA_OP(Y,  export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(AY, export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(EY, export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(S,  export_list<bool>, (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_OP(AS, export_list<bool>, (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_OP(ES, export_list<bool>, (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_OP(P,  export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(AP, export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(EP, export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(I,  export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(C,  export_list<bool>, (bool f), (f));
+    FCPP_FORMULA_OP(F,  export_list<horizon_t>, (bool f), (f));
+    FCPP_FORMULA_OP(R,  export_list<horizon_t>, (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_BOUNDED_OP(S_within,  (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_BOUNDED_OP(AS_within, (bool f1, bool f2), (f1, f2));
+    FCPP_FORMULA_BOUNDED_OP(ES_within, (bool f1, bool f2), (f1, f2));
+
+    #undef FCPP_FORMULA_OP
+    #undef FCPP_FORMULA_BOUNDED_OP
+    #undef FCPP_FORMULA_UNPACK
+}
+
+
+//! @brief Namespace of implementation details.
+namespace details {
+    //! @brief Whether a type is a formula.
+    template <typename F>
+    using is_formula = std::is_base_of<expr, F>;
+
+    //! @brief Enables a type if all arguments are formulas.
+    template <typename T, typename F, typename G = top>
+    using if_formula = std::enable_if_t<is_formula<F>::value and is_formula<G>::value, T>;
+
+    //! @brief Folds redundancies at the top of a formula whose arguments are already simplified.
+    template <typename E>
+    struct simplify {
+        using type = E;
+    };
+
+    //! @brief The simplified version of a formula.
+    template <typename E>
+    using simplify_t = typename simplify<E>::type;
+
+    //! @brief Double negation.
+    template <typename F>
+    struct simplify<not_t<not_t<F>>> {
+        using type = F;
+    };
+
+    //! @brief Negation of a constant.
+    template <bool b>
+    struct simplify<not_t<constant<b>>> {
+        using type = constant<not b>;
+    };
+
+    //! @brief Conjunction with constants, repeated or complementary arguments.
+    template <typename F, typename G>
+    struct simplify<and_t<F, G>> {
+        using type = std::conditional_t<
+            std::is_same<F, bottom>::value or std::is_same<G, bottom>::value or std::is_same<G, simplify_t<not_t<F>>>::value,
+            bottom,
+            std::conditional_t<
+                std::is_same<F, top>::value or std::is_same<F, G>::value,
+                G,
+                std::conditional_t<std::is_same<G, top>::value, F, and_t<F, G>>
+            >
+        >;
+    };
+
+    //! @brief Disjunction with constants, repeated or complementary arguments.
+    template <typename F, typename G>
+    struct simplify<or_t<F, G>> {
+        using type = std::conditional_t<
+            std::is_same<F, top>::value or std::is_same<G, top>::value or std::is_same<G, simplify_t<not_t<F>>>::value,
+            top,
+            std::conditional_t<
+                std::is_same<F, bottom>::value or std::is_same<F, G>::value,
+                G,
+                std::conditional_t<std::is_same<G, bottom>::value, F, or_t<F, G>>
+            >
+        >;
+    };
+
+    //! @brief Operators which are idempotent and preserve constants.
+    template <typename O>
+    struct is_closure : std::false_type {};
+    template <>
+    struct is_closure<ops::P> : std::true_type {};
+    template <>
+    struct is_closure<ops::AP> : std::true_type {};
+    template <>
+    struct is_closure<ops::EP> : std::true_type {};
+
+    //! @brief Operators preserving constants.
+    template <typename O>
+    struct is_constant_preserving : is_closure<O> {};
+    template <>
+    struct is_constant_preserving<ops::I> : std::true_type {};
+    template <>
+    struct is_constant_preserving<ops::C> : std::true_type {};
+    template <>
+    struct is_constant_preserving<ops::F> : std::true_type {};
+
+    //! @brief Unary operators on constants or repeated closures.
+    template <typename O, typename F>
+    struct simplify<op_t<O, F>> {
+        using type = std::conditional_t<
+            is_constant_preserving<O>::value and (std::is_same<F, top>::value or std::is_same<F, bottom>::value),
+            F, op_t<O, F>
+        >;
+    };
+
+    //! @brief Repeated closures.
+    template <typename O, typename F>
+    struct simplify<op_t<O, op_t<O, F>>> {
+        using type = std::conditional_t<is_closure<O>::value, op_t<O, F>, op_t<O, op_t<O, F>>>;
+    };
+
+    //! @brief A sequence of types.
+    template <typename... Ts>
+    struct type_list {};
+
+    //! @brief A sequence of truth values.
+    template <bool... bs>
+    struct bool_list {};
+
+    //! @brief Appends a type to a sequence, if not already present.
+    template <typename L, typename T>
+    struct append_unique;
+    template <typename... Ts, typename T>
+    struct append_unique<type_list<Ts...>, T> {
+        using type = std::conditional_t<
+            std::is_same<bool_list<false, std::is_same<Ts, T>::value...>, bool_list<std::is_same<Ts, T>::value..., false>>::value,
+            type_list<Ts..., T>,
+            type_list<Ts...>
+        >;
+    };
+
+    //! @brief Appends the operator applications in a formula to a sequence, in evaluation order.
+    template <typename E, typename L>
+    struct collect {
+        using type = L;
+    };
+    template <typename F, typename L>
+    struct collect<not_t<F>, L> : collect<F, L> {};
+    template <typename F, typename G, typename L>
+    struct collect<and_t<F, G>, L> : collect<G, typename collect<F, L>::type> {};
+    template <typename F, typename G, typename L>
+    struct collect<or_t<F, G>, L> : collect<G, typename collect<F, L>::type> {};
+    template <typename O, typename F, typename L>
+    struct collect<op_t<O, F>, L> {
+        using type = typename append_unique<typename collect<F, L>::type, op_t<O, F>>::type;
+    };
+    template <typename O, typename F, typename G, typename L>
+    struct collect<op_t<O, F, G>, L> {
+        using type = typename append_unique<typename collect<G, typename collect<F, L>::type>::type, op_t<O, F, G>>::type;
+    };
+
+    template <typename S, typename E, typename L>
+    struct collect<named_monitor<S, E>, L> : collect<E, L> {};
+    template <typename E, typename... Es, typename L>
+    struct collect<std::tuple<E, Es...>, L> : collect<std::tuple<Es...>, typename collect<E, L>::type> {};
+
+    //! @brief The distinct operator applications in a formula (or tuple of monitors), in evaluation order.
+    template <typename E>
+    using collect_t = typename collect<E, type_list<>>::type;
+
+    //! @brief Position of a type in a sequence.
+    template <typename L, typename T>
+    struct index_of;
+    template <typename T, typename... Ts>
+    struct index_of<type_list<T, Ts...>, T> : std::integral_constant<size_t, 0> {};
+    template <typename U, typename... Ts, typename T>
+    struct index_of<type_list<U, Ts...>, T> : std::integral_constant<size_t, 1 + index_of<type_list<Ts...>, T>::value> {};
+
+    //! @brief Length of a sequence.
+    template <typename L>
+    struct size_of;
+    template <typename... Ts>
+    struct size_of<type_list<Ts...>> : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+    //! @brief Type at a position in a sequence.
+    template <typename L, size_t i>
+    struct type_at;
+    template <typename... Ts, size_t i>
+    struct type_at<type_list<Ts...>, i> {
+        using type = std::tuple_element_t<i, std::tuple<Ts...>>;
+    };
+
+    //! @brief The exports of an operator application.
+    template <typename E>
+    struct op_exports;
+    template <typename O, typename... Fs>
+    struct op_exports<op_t<O, Fs...>> {
+        using type = typename O::exports;
+    };
+
+    //! @brief The exports of a sequence of operator applications.
+    template <typename L>
+    struct exports_of;
+    template <typename... Ts>
+    struct exports_of<type_list<Ts...>> {
+        using type = export_list<typename op_exports<Ts>::type...>;
+    };
+
+    //! @brief Values of formulas given propositions and the results of the operator applications in a sequence.
+    template <typename L, typename T>
+    struct evaluator {
+        //! @brief The propositions.
+        T const& props;
+        //! @brief The results of the operator applications.
+        bool* results;
+
+        //! @brief Value of a proposition.
+        template <size_t i>
+        bool value(prop<i>) const {
+            return bool(std::get<i>(props));
+        }
+
+        //! @brief Value of a constant.
+        template <bool b>
+        bool value(constant<b>) const {
+            return b;
+        }
+
+        //! @brief Value of a negation.
+        template <typename F>
+        bool value(not_t<F>) const {
+            return not value(F{});
+        }
+
+        //! @brief Value of a conjunction.
+        template <typename F, typename G>
+        bool value(and_t<F, G>) const {
+            return value(F{}) & value(G{});
+        }
+
+        //! @brief Value of a disjunction.
+        template <typename F, typename G>
+        bool value(or_t<F, G>) const {
+            return value(F{}) | value(G{});
+        }
+
+        //! @brief Value of an operator application (already computed).
+        template <typename O, typename... Fs>
+        bool value(op_t<O, Fs...>) const {
+            return results[index_of<L, op_t<O, Fs...>>::value];
+        }
+
+        //! @brief Value of a plain formula among monitors.
+        template <typename node_t, typename F>
+        bool store(node_t&, F) const {
+            return value(F{});
+        }
+
+        //! @brief Value of a named monitor, also stored under its tag.
+        template <typename node_t, typename S, typename F>
+        bool store(node_t& node, named_monitor<S, F>) const {
+            return node.storage(S{}) = value(F{});
+        }
+
+        //! @brief Computes an operator application, given the results of the previous ones.
+        template <typename node_t, typename O, typename... Fs>
+        bool apply(node_t& node, trace_t call_point, op_t<O, Fs...>) const {
+            return O::apply(node, call_point, value(Fs{})...);
+        }
+    };
+
+    //! @brief Computes the operator applications of a formula in order, each with its own trace.
+    template <typename L, typename node_t, typename T, size_t... is>
+    void apply_all(node_t& node, trace_t call_point, evaluator<L, T> const& e, std::index_sequence<is...>) {
+        int dummy[] = {0, (e.results[is] = [&](){
+            internal::trace_key trace_process(node.stack_trace, is);
+            return e.apply(node, call_point, typename type_at<L, is>::type{});
+        }(), 0)...};
+        (void)dummy;
+    }
+}
+
+//! @brief The export list of a formula or tuple of monitors (the exports of its operators, each counted once).
+template <typename E>
+using exports = typename details::exports_of<details::collect_t<std::decay_t<E>>>::type;
+
+//! @brief Evaluates a formula on given propositions, computing every distinct subformula once.
+template <typename node_t, typename E, typename... Ts>
+details::if_formula<bool, E> evaluate(ARGS, E, Ts const&... props) { CODE
+    using list_t = details::collect_t<E>;
+    constexpr size_t n = details::size_of<list_t>::value;
+    std::tuple<Ts const&...> t(props...);
+    std::array<bool, n> results;
+    details::evaluator<list_t, std::tuple<Ts const&...>> e{t, results.data()};
+    details::apply_all<list_t>(node, call_point, e, std::make_index_sequence<n>{});
+    return e.value(E{});
+}
+
+/**
+ * @brief Evaluates monitors on given propositions, computing every distinct subformula once.
+ *
+ * The monitors may be named (whose values are also stored under their tags) or
+ * plain formulas, and their values are returned in order.
+ */
+template <typename node_t, typename... Es, typename... Ts>
+std::array<bool, sizeof...(Es)> evaluate(ARGS, std::tuple<Es...> const&, Ts const&... props) { CODE
+    using list_t = details::collect_t<std::tuple<Es...>>;
+    constexpr size_t n = details::size_of<list_t>::value;
+    std::tuple<Ts const&...> t(props...);
+    std::array<bool, n> results;
+    details::evaluator<list_t, std::tuple<Ts const&...>> e{t, results.data()};
+    details::apply_all<list_t>(node, call_point, e, std::make_index_sequence<n>{});
+    return {e.store(node, Es{})...};
+}
+
+//! @brief A monitor storing the value of a formula under a tag S.
+template <typename S, typename E>
+constexpr details::if_formula<named_monitor<S, E>, E> monitor(E) {
+    return {};
+}
+
+
+//! @brief Negation.
+template <typename E>
+constexpr details::if_formula<details::simplify_t<not_t<E>>, E> operator!(E) {
+    return {};
+}
+
+//! @brief Conjunction.
+template <typename E, typename G>
+constexpr details::if_formula<details::simplify_t<and_t<E, G>>, E, G> operator&(E, G) {
+    return {};
+}
+
+//! @brief Disjunction.
+template <typename E, typename G>
+constexpr details::if_formula<details::simplify_t<or_t<E, G>>, E, G> operator|(E, G) {
+    return {};
+}
+
+//! @brief Implication.
+template <typename E, typename G>
+constexpr auto operator<=(E f, G g) -> details::if_formula<decltype(!f | g), E, G> {
+    return {};
+}
+
+//! @brief Declares a unary operator building a formula.
+#define FCPP_FORMULA_UNARY(name, op)                                    \
+template <typename E>                                                   \
+constexpr details::if_formula<details::simplify_t<op_t<op, E>>, E> name(E) { \
+    return {};                                                          \
+}
+
+//! @brief Declares a binary operator building a formula.
+#define FCPP_FORMULA_BINARY(name, op)                                   \
+template <typename E, typename G>                                       \
+constexpr details::if_formula<op_t<op, E, G>, E, G> name(E, G) {        \
+    return {};                                                          \
+}
+
+//! @brief Yesterday in the same device.
+FCPP_FORMULA_UNARY(Y, ops::Y)
+//! @brief Yesterday in all devices.
+FCPP_FORMULA_UNARY(AY, ops::AY)
+//! @brief Yesterday in some device.
+FCPP_FORMULA_UNARY(EY, ops::EY)
+//! @brief f1 holds since f2 held in the same device.
+FCPP_FORMULA_BINARY(S, ops::S)
+//! @brief f1 holds since f2 held in all devices.
+FCPP_FORMULA_BINARY(AS, ops::AS)
+//! @brief f1 holds since f2 held in any device.
+FCPP_FORMULA_BINARY(ES, ops::ES)
+//! @brief Previously in the same device.
+FCPP_FORMULA_UNARY(P, ops::P)
+//! @brief Previously in all devices.
+FCPP_FORMULA_UNARY(AP, ops::AP)
+//! @brief Previously in any device.
+FCPP_FORMULA_UNARY(EP, ops::EP)
+//! @brief Interior of a region.
+FCPP_FORMULA_UNARY(I, ops::I)
+//! @brief Closure of a region.
+FCPP_FORMULA_UNARY(C, ops::C)
+//! @brief Somewhere in the network.
+FCPP_FORMULA_UNARY(F, ops::F)
+//! @brief f2 is reachable through f1.
+FCPP_FORMULA_BINARY(R, ops::R)
+
+#undef FCPP_FORMULA_UNARY
+#undef FCPP_FORMULA_BINARY
+
+//! @brief Historically in the same device.
+template <typename E>
+constexpr auto H(E f) {
+    return !P(!f);
+}
+
+//! @brief Historically in all devices.
+template <typename E>
+constexpr auto AH(E f) {
+    return !EP(!f);
+}
+
+//! @brief Historically in any device.
+template <typename E>
+constexpr auto EH(E f) {
+    return !AP(!f);
+}
+
+//! @brief Boundary of a region.
+template <typename E>
+constexpr auto B(E f) {
+    return C(f) & !I(f);
+}
+
+//! @brief Interior boundary of a region.
+template <typename E>
+constexpr auto IB(E f) {
+    return f & !I(f);
+}
+
+//! @brief Closure boundary of a region.
+template <typename E>
+constexpr auto CB(E f) {
+    return C(f) & !f;
+}
+
+//! @brief Everywhere in the network.
+template <typename E>
+constexpr auto G(E f) {
+    return !F(!f);
+}
+
+//! @brief f2 is touched through f1.
+template <typename F1, typename F2>
+constexpr auto T(F1 f1, F2 f2) {
+    return R(f1, C(f2));
+}
+
+//! @brief f1 is surrounded by f2.
+template <typename F1, typename F2>
+constexpr auto U(F1 f1, F2 f2) {
+    return f1 & I(!R(!f2, !f1));
+}
+
+//! @brief f1 holds since f2 held in the same device, in the last t seconds.
+template <intmax_t t, typename F1, typename F2>
+constexpr details::if_formula<op_t<ops::S_within<t>, F1, F2>, F1, F2> S_within(F1, F2) {
+    return {};
+}
+
+//! @brief f1 holds since f2 held in all devices, in the last t seconds.
+template <intmax_t t, typename F1, typename F2>
+constexpr details::if_formula<op_t<ops::AS_within<t>, F1, F2>, F1, F2> AS_within(F1, F2) {
+    return {};
+}
+
+//! @brief f1 holds since f2 held in any device, in the last t seconds.
+template <intmax_t t, typename F1, typename F2>
+constexpr details::if_formula<op_t<ops::ES_within<t>, F1, F2>, F1, F2> ES_within(F1, F2) {
+    return {};
+}
+
+//! @brief Previously in the same device, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto P_within(E f) {
+    return S_within<t>(top{}, f);
+}
+
+//! @brief Previously in all devices, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto AP_within(E f) {
+    return AS_within<t>(top{}, f);
+}
+
+//! @brief Previously in any device, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto EP_within(E f) {
+    return ES_within<t>(top{}, f);
+}
+
+//! @brief Historically in the same device, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto H_within(E f) {
+    return !P_within<t>(!f);
+}
+
+//! @brief Historically in all devices, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto AH_within(E f) {
+    return !EP_within<t>(!f);
+}
+
+//! @brief Historically in any device, in the last t seconds.
+template <intmax_t t, typename E>
+constexpr auto EH_within(E f) {
+    return !AP_within<t>(!f);
+}
+
+}
+
+}
+
+}
+
+#endif // FCPP_FORMULA_H_
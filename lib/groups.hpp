@@ -0,0 +1,115 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file groups.hpp
+ * @brief Implementation of the spawning of groups read from a data file at runtime.
+ */
+
+#ifndef FCPP_GROUPS_H_
+#define FCPP_GROUPS_H_
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/fcpp.hpp"
+#include "lib/movement.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Description of a group of devices moving together.
+struct group_spec {
+    //! @brief Number of devices.
+    size_t size;
+    //! @brief Radius of the group.
+    real_t radius;
+    //! @brief Speed of the group in km/h.
+    real_t speed;
+    //! @brief Time at which the devices are spawned.
+    times_t start;
+    //! @brief Starting position of the devices (negative for random positions).
+    vec<2> position;
+};
+
+//! @brief The first group identifier used for groups read from files (after those spawned through options).
+constexpr size_t first_data_group = 256;
+
+/**
+ * @brief Reads the groups in a CSV file (empty if it cannot be read).
+ *
+ * Every line holds the size, radius, speed (km/h), start time and optionally
+ * the starting coordinates of a group, separated by commas. Empty lines, lines
+ * starting with `#` and lines that do not start with a number (such as headers)
+ * are skipped. Malformed lines are reported and skipped, and reading stops with
+ * an error after as many groups as can be spawned from `first_data_group` on.
+ */
+inline std::vector<group_spec> read_groups(std::string const& file) {
+    std::vector<group_spec> groups;
+    std::ifstream in(file);
+    size_t n = 0;
+    for (std::string line; std::getline(in, line); ) {
+        ++n;
+        for (char& c : line) if (c == ',') c = ' ';
+        std::istringstream ss(line);
+        group_spec g{0, 0, 0, 0, make_vec(-1, -1)};
+        real_t first;
+        if (not (ss >> first))
+            continue;
+        ss.seekg(0);
+        if (not (ss >> g.size >> g.radius >> g.speed >> g.start) or g.size == 0) {
+            std::cerr << file << ":" << n << ": malformed group skipped" << std::endl;
+            continue;
+        }
+        if (first_data_group + groups.size() >= leader_snapshot::max_groups) {
+            std::cerr << file << ":" << n << ": too many groups (at most " << leader_snapshot::max_groups - first_data_group << "), the rest are ignored" << std::endl;
+            break;
+        }
+        real_t x, y;
+        if (ss >> x >> y) g.position = make_vec(x, y);
+        groups.push_back(g);
+    }
+    return groups;
+}
+
+/**
+ * @brief Spawns groups in a simulated network, returning the number of devices spawned.
+ *
+ * Groups are numbered from a first group identifier, and devices are given
+ * consecutive identifiers from a first device identifier (after those used by
+ * groups spawned through options), so that groups can be of any size. Spawning
+ * stops with an error at the first group beyond the maximum group identifier.
+ */
+template <typename N>
+size_t spawn_groups(N& network, std::vector<group_spec> const& groups, size_t first_group = first_data_group, device_t first_uid = device_t(first_data_group * max_group_size)) {
+    using namespace component::tags;
+    using namespace coordination::tags;
+    std::mt19937_64 rng(first_uid);
+    std::uniform_real_distribution<real_t> rx(0, hi_x), ry(0, hi_y);
+    device_t id = first_uid;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        group_spec const& g = groups[i];
+        if (first_group + i >= leader_snapshot::max_groups) {
+            std::cerr << "group " << first_group + i << " exceeds the maximum group identifier " << leader_snapshot::max_groups - 1 << ", the rest are not spawned" << std::endl;
+            break;
+        }
+        device_t leader_id = id;
+        for (size_t j = 0; j < g.size; ++j) {
+            vec<2> p = g.position[0] < 0 ? make_vec(rx(rng), ry(rng)) : g.position;
+            network.node_emplace(common::make_tagged_tuple<uid, start, x, speed, offset, group, leader>(
+                id++, g.start, p, g.speed * 1000 / 3600, g.radius, group_t(first_group + i), leader_id
+            ));
+        }
+    }
+    return id - first_uid;
+}
+
+}
+
+#endif // FCPP_GROUPS_H_
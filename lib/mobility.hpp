@@ -0,0 +1,411 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file mobility.hpp
+ * @brief Implementation of the recording and replaying of mobility traces, and of checkpoints of positions and time.
+ */
+
+#ifndef FCPP_MOBILITY_H_
+#define FCPP_MOBILITY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lib/beautify.hpp"
+#include "lib/coordination/utils.hpp"
+
+//! @brief Whether the positions of devices are recorded in a mobility trace.
+#ifndef FCPP_MOBILITY_RECORD
+#define FCPP_MOBILITY_RECORD false
+#endif
+
+//! @brief Whether the positions of devices are replayed from a mobility trace (instead of computing their movement).
+#ifndef FCPP_MOBILITY_REPLAY
+#define FCPP_MOBILITY_REPLAY false
+#endif
+
+//! @brief The file of the mobility trace.
+#ifndef FCPP_MOBILITY_FILE
+#define FCPP_MOBILITY_FILE "mobility.trace"
+#endif
+
+//! @brief The number of samples buffered before being written to a mobility trace as a chunk.
+#ifndef FCPP_MOBILITY_CHUNK
+#define FCPP_MOBILITY_CHUNK 65536
+#endif
+
+//! @brief The time at which the positions of devices (and the time) are saved to a checkpoint (negative for no checkpoint).
+#ifndef FCPP_CHECKPOINT_TIME
+#define FCPP_CHECKPOINT_TIME -1
+#endif
+
+//! @brief Whether devices are moved to their positions in a checkpoint on their first round (continuing from its time).
+#ifndef FCPP_CHECKPOINT_RESTORE
+#define FCPP_CHECKPOINT_RESTORE false
+#endif
+
+//! @brief The file of the checkpoint (a mobility trace with one sample per device, at the time it was saved).
+#ifndef FCPP_CHECKPOINT_FILE
+#define FCPP_CHECKPOINT_FILE "warmup.checkpoint"
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Format of mobility traces.
+ *
+ * The file starts with the magic `FCPPMOB2`, followed by chunks in the order they
+ * were written. Each chunk is made of its number of devices and of samples (uint64
+ * each), an index with an entry for every device in increasing identifier order,
+ * made of the identifier, the position of its first sample in the chunk and its
+ * number of samples (uint64 each), and the samples, grouped by device in increasing
+ * time order, each made of the time (float64) and the coordinates (float32 each),
+ * in native byte order. The samples of a device in later chunks are later in time,
+ * and a truncated last chunk (as left by a crash) is ignored.
+ */
+namespace mobility {
+    //! @brief An entry of the index.
+    struct entry {
+        //! @brief Identifier of the device.
+        uint64_t uid;
+        //! @brief Position of the first sample of the device.
+        uint64_t first;
+        //! @brief Number of samples of the device.
+        uint64_t count;
+    };
+
+    //! @brief A sample of the position of a device.
+    struct sample {
+        //! @brief Time of the sample.
+        double time;
+        //! @brief First coordinate of the position.
+        float x;
+        //! @brief Second coordinate of the position.
+        float y;
+    };
+}
+
+
+/**
+ * @brief Recorder of the positions of devices in their rounds, written as a mobility trace.
+ *
+ * Samples are buffered in memory and written as a chunk (sorted by device) every
+ * FCPP_MOBILITY_CHUNK samples, and on exit, so that memory stays bounded and a
+ * crash loses at most the samples of the last chunk.
+ */
+class mobility_recorder {
+  public:
+    //! @brief The recorder of the mobility trace.
+    static mobility_recorder& instance() {
+        static mobility_recorder r(FCPP_MOBILITY_FILE);
+        return r;
+    }
+
+    //! @brief The recorder of the checkpoint.
+    static mobility_recorder& checkpoint() {
+        static mobility_recorder r(FCPP_CHECKPOINT_FILE);
+        return r;
+    }
+
+    //! @brief Records the position of a device at a given time.
+    void record(device_t uid, times_t time, vec<2> const& p) {
+        std::lock_guard<std::mutex> l(m_lock);
+        m_records.push_back({uint64_t(uid), {double(time), float(p[0]), float(p[1])}});
+        if (m_records.size() >= FCPP_MOBILITY_CHUNK)
+            flush();
+    }
+
+  private:
+    //! @brief A sample of a device.
+    struct record_t {
+        //! @brief Identifier of the device.
+        uint64_t uid;
+        //! @brief The sample.
+        mobility::sample s;
+    };
+
+    //! @brief Constructor given the file name.
+    mobility_recorder(std::string const& file) : m_file(file) {}
+
+    //! @brief Destructor, writing the last chunk and closing the trace.
+    ~mobility_recorder() {
+        flush();
+        if (m_out != nullptr) std::fclose(m_out);
+    }
+
+    //! @brief Writes the samples buffered as a chunk (opening the trace on the first chunk).
+    void flush() {
+        if (m_records.empty()) return;
+        if (m_out == nullptr) {
+            m_out = std::fopen(m_file.c_str(), "wb");
+            if (m_out == nullptr) {
+                m_records.clear();
+                return;
+            }
+            std::fwrite("FCPPMOB2", 1, 8, m_out);
+        }
+        std::stable_sort(m_records.begin(), m_records.end(), [](record_t const& a, record_t const& b) {
+            return a.uid < b.uid or (a.uid == b.uid and a.s.time < b.s.time);
+        });
+        m_index.clear();
+        m_samples.clear();
+        for (record_t const& r : m_records) {
+            if (m_index.empty() or m_index.back().uid != r.uid)
+                m_index.push_back({r.uid, m_samples.size(), 0});
+            ++m_index.back().count;
+            m_samples.push_back(r.s);
+        }
+        uint64_t n[2] = {m_index.size(), m_samples.size()};
+        std::fwrite(n, sizeof(uint64_t), 2, m_out);
+        std::fwrite(m_index.data(), sizeof(mobility::entry), m_index.size(), m_out);
+        std::fwrite(m_samples.data(), sizeof(mobility::sample), m_samples.size(), m_out);
+        std::fflush(m_out);
+        m_records.clear();
+    }
+
+    //! @brief The file name.
+    std::string m_file;
+    //! @brief Lock guarding the samples.
+    std::mutex m_lock;
+    //! @brief The samples buffered.
+    std::vector<record_t> m_records;
+    //! @brief The index of the chunk being written.
+    std::vector<mobility::entry> m_index;
+    //! @brief The samples of the chunk being written.
+    std::vector<mobility::sample> m_samples;
+    //! @brief The trace file (null until the first chunk is written).
+    std::FILE* m_out = nullptr;
+};
+
+
+/**
+ * @brief Mobility trace replayed, memory-mapped where supported.
+ *
+ * The position of a device between two samples is interpolated linearly, and the
+ * device is given the velocity towards the next sample. Samples are read in place,
+ * through an index of the runs of samples of every device in the chunks.
+ */
+class mobility_trace {
+  public:
+    //! @brief The mobility trace (read on first access).
+    static mobility_trace const& instance() {
+        static mobility_trace t(FCPP_MOBILITY_FILE);
+        return t;
+    }
+
+    //! @brief The checkpoint (read on first access).
+    static mobility_trace const& checkpoint() {
+        static mobility_trace t(FCPP_CHECKPOINT_FILE);
+        return t;
+    }
+
+    //! @brief Copies are not allowed.
+    mobility_trace(mobility_trace const&) = delete;
+
+    //! @brief Destructor (unmapping the file).
+    ~mobility_trace() {
+#ifndef _WIN32
+        if (m_data != nullptr)
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    //! @brief The last sample of a device, returning whether the device is in the trace.
+    bool last(device_t uid, times_t& time, vec<2>& position) const {
+        mobility::entry const* e = find(uid);
+        if (e == nullptr) return false;
+        run const& r = m_runs[e->first + e->count - 1];
+        mobility::sample const& s = r.first[r.count - 1];
+        time = s.time;
+        position = make_vec(s.x, s.y);
+        return true;
+    }
+
+    //! @brief The position and velocity of a device at a given time, returning whether the device is in the trace.
+    bool at(device_t uid, times_t time, vec<2>& position, vec<2>& velocity) const {
+        mobility::entry const* e = find(uid);
+        if (e == nullptr) return false;
+        run const* b = m_runs.data() + e->first;
+        run const* r = std::upper_bound(b, b + e->count, double(time), [](double t, run const& a) {
+            return t < a.first->time;
+        });
+        if (r != b) --r;
+        mobility::sample const* s = std::upper_bound(r->first, r->first + r->count, double(time), [](double t, mobility::sample const& a) {
+            return t < a.time;
+        });
+        if (s != r->first) --s;
+        // the next sample, possibly starting the next run
+        mobility::sample const* n = s + 1 != r->first + r->count ? s + 1 : r + 1 != b + e->count ? r[1].first : nullptr;
+        position = make_vec(s->x, s->y);
+        velocity = make_vec(0, 0);
+        if (n != nullptr and s->time < time) {
+            velocity = make_vec(n->x - s->x, n->y - s->y) * real_t(1 / (n->time - s->time));
+            position = position + velocity * real_t(time - s->time);
+        }
+        return true;
+    }
+
+  private:
+    //! @brief A run of samples of a device in a chunk.
+    struct run {
+        //! @brief The first sample.
+        mobility::sample const* first;
+        //! @brief The number of samples.
+        uint64_t count;
+    };
+
+    //! @brief The index entry of a device with samples (null if missing), pointing to its runs.
+    mobility::entry const* find(device_t uid) const {
+        auto e = std::lower_bound(m_index.begin(), m_index.end(), uint64_t(uid), [](mobility::entry const& a, uint64_t u) {
+            return a.uid < u;
+        });
+        return e == m_index.end() or e->uid != uint64_t(uid) ? nullptr : &*e;
+    }
+
+    //! @brief Constructor given the file name (empty if it cannot be read).
+    mobility_trace(std::string const& file) {
+#ifndef _WIN32
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 and st.st_size > 0) {
+            void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                m_data = static_cast<char const*>(m);
+                m_size = st.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::FILE* f = std::fopen(file.c_str(), "rb");
+        if (f == nullptr) return;
+        char buf[4096];
+        for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;)
+            m_buffer.insert(m_buffer.end(), buf, buf + n);
+        std::fclose(f);
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+        parse();
+    }
+
+    //! @brief Parses the chunks into the index, up to the first malformed or truncated one.
+    void parse() {
+        if (m_size < 8 or std::memcmp(m_data, "FCPPMOB2", 8) != 0) return;
+        // runs of every device tagged with its identifier, in chunk order
+        std::vector<std::pair<uint64_t, run>> runs;
+        for (size_t offset = 8; offset + 16 <= m_size;) {
+            uint64_t n[2];
+            std::memcpy(n, m_data + offset, sizeof(n));
+            size_t samples = offset + 16 + n[0] * sizeof(mobility::entry);
+            if (n[0] > m_size or n[1] > m_size or samples + n[1] * sizeof(mobility::sample) > m_size) break;
+            mobility::entry const* index = reinterpret_cast<mobility::entry const*>(m_data + offset + 16);
+            mobility::sample const* first = reinterpret_cast<mobility::sample const*>(m_data + samples);
+            bool valid = true;
+            for (size_t i = 0; i < n[0]; ++i)
+                valid = valid and index[i].count > 0 and index[i].first + index[i].count <= n[1];
+            if (not valid) break;
+            for (size_t i = 0; i < n[0]; ++i)
+                runs.push_back({index[i].uid, {first + index[i].first, index[i].count}});
+            offset = samples + n[1] * sizeof(mobility::sample);
+        }
+        std::stable_sort(runs.begin(), runs.end(), [](auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+        for (auto const& r : runs) {
+            if (m_index.empty() or m_index.back().uid != r.first)
+                m_index.push_back({r.first, m_runs.size(), 0});
+            ++m_index.back().count;
+            m_runs.push_back(r.second);
+        }
+    }
+
+    //! @brief The content of the file.
+    char const* m_data = nullptr;
+    //! @brief The size of the file.
+    size_t m_size = 0;
+#ifdef _WIN32
+    //! @brief The content of the file (where it cannot be mapped).
+    std::vector<char> m_buffer;
+#endif
+    //! @brief The index of devices, with the position and number of their runs.
+    std::vector<mobility::entry> m_index;
+    //! @brief The runs of samples of devices, grouped by device in increasing time order.
+    std::vector<run> m_runs;
+};
+
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Records the position of a node in the current round in the mobility trace.
+template <typename node_t>
+void mobility_record(node_t& node) {
+    mobility_recorder::instance().record(node.uid, node.current_time(), node.position());
+}
+
+//! @brief Moves a node as in the mobility trace, returning whether the node is in the trace.
+template <typename node_t>
+bool mobility_replay(node_t& node) {
+    vec<2> p, v;
+    if (not mobility_trace::instance().at(node.uid, node.current_time(), p, v))
+        return false;
+    node.position() = p;
+    node.velocity() = v;
+    return true;
+}
+
+//! @brief Saves the position of the device and the current time to the checkpoint, in its first round after a given time.
+FUN void checkpoint_save(ARGS, times_t t) { CODE
+    old(CALL, false, [&](bool saved){
+        if (saved or t < 0 or node.current_time() < t) return saved;
+        mobility_recorder::checkpoint().record(node.uid, node.current_time(), node.position());
+        return true;
+    });
+}
+//! @brief Export list for checkpoint_save.
+FUN_EXPORT checkpoint_save_t = export_list<bool>;
+
+/**
+ * @brief Moves the device to its position in the checkpoint on its first round.
+ *
+ * Returns the time at which the position was saved (zero for devices not in the
+ * checkpoint), by which the device is ahead of the current time: only positions
+ * and time are restored, so that monitors still start with an empty history.
+ */
+FUN times_t checkpoint_restore(ARGS) { CODE
+    return old(CALL, times_t(-1), [&](times_t w){
+        if (w >= 0) return w;
+        times_t t;
+        vec<2> p;
+        if (not mobility_trace::checkpoint().last(node.uid, t, p))
+            return times_t(0);
+        node.position() = p;
+        return t;
+    });
+}
+//! @brief Export list for checkpoint_restore.
+FUN_EXPORT checkpoint_restore_t = export_list<times_t>;
+
+}
+
+}
+
+#endif // FCPP_MOBILITY_H_
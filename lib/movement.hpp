@@ -8,7 +8,37 @@
 #ifndef FCPP_MOVEMENT_H_
 #define FCPP_MOVEMENT_H_
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
 #include "lib/fcpp.hpp"
+#include "lib/navigation.hpp"
+#include "lib/profiler.hpp"
+#include "lib/random.hpp"
+#include "lib/registry.hpp"
+
+//! @brief Obstacles image keying the cache of closest free spaces (empty for no cache).
+#ifndef FCPP_OBSTACLES_MAP
+#define FCPP_OBSTACLES_MAP "obstacles.png"
+#endif
+
+/**
+ * @brief Whether random targets are drawn from streams keyed by device and target count.
+ *
+ * The targets drawn by a device then depend only on its stream key and identifier,
+ * and not on the draws of other devices in between. This alone does not make runs
+ * with `parallel<true>` reproducible: the times of rounds are still drawn from the
+ * generator of the simulation (as by the Weibull intervals of `round_s`), and
+ * followers read the position of their leader as last published, which depends on
+ * how rounds interleave across threads. Runs with `parallel<false>` (as in batches)
+ * are reproducible for a given seed.
+ */
+#ifndef FCPP_DETERMINISTIC
+#define FCPP_DETERMINISTIC false
+#endif
 
 
 /**
@@ -16,13 +46,16 @@
  */
 namespace fcpp {
 
-//! @brief Maximum allowed group size.
-constexpr int max_group_size = 100;
+//! @brief Maximum allowed size of groups spawned through options (the stride between the identifiers of their devices).
+constexpr int max_group_size = 1 << 16;
 //! @brief Width of the map.
 constexpr int hi_x = 1200;
 //! @brief Height of the map.
 constexpr int hi_y = 800;
 
+//! @brief Type of group identifiers.
+using group_t = uint32_t;
+
 //! @brief Namespace containing the libraries of coordination routines.
 namespace coordination {
 
@@ -34,66 +67,196 @@ namespace tags {
     struct speed {};
     //! @brief Offset radius for the current node.
     struct offset {};
+    //! @brief Group of the current node.
+    struct group {};
+    //! @brief Leader of the group of the current node.
+    struct leader {};
+    //! @brief Key of the random stream of the current node (with FCPP_DETERMINISTIC).
+    struct stream {};
+    //! @brief Number of random targets drawn by the current node (with FCPP_DETERMINISTIC).
+    struct target_round {};
+    //! @brief Time simulated before the current one, in the warm-up run the node was restored from.
+    struct warmup {};
+    //! @brief State of group movement, shared by the nodes of the network.
+    struct shared_walk {};
+}
+
+//! @brief Key of the navigator of a network, digesting its closest free spaces to a lattice of points.
+template <typename node_t>
+uint64_t navigator_key(node_t& node) {
+    constexpr size_t n = 16;
+    uint64_t h = details::mix(hi_x, hi_y);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j) {
+            vec<2> q = node.net.closest_space(make_vec((i + 0.5) * hi_x / n, (j + 0.5) * hi_y / n));
+            h = details::mix(h, details::mix(uint64_t(int64_t(q[0] * 64)), uint64_t(int64_t(q[1] * 64))));
+        }
+    return h;
+}
+
+}
+
+/**
+ * @brief State of group movement held once per network: the snapshot of group leaders and the grid of closest free spaces.
+ *
+ * Devices reach it through a single `network_ref` in their storage (see `walk_state_of`).
+ */
+class walk_state {
+  public:
+    //! @brief Snapshot of the group leaders.
+    leader_snapshot snapshot;
+
+    //! @brief The grid of closest free spaces, built from the navigator of the first node accessing it.
+    template <typename node_t>
+    closest_space_grid& grid(node_t& node) {
+        std::call_once(m_built, [&](){
+            m_grid.reset(new closest_space_grid(hi_x, hi_y, FCPP_OBSTACLES_MAP, coordination::navigator_key(node)));
+        });
+        return *m_grid;
+    }
+
+  private:
+    //! @brief Whether the grid has been built.
+    std::once_flag m_built;
+    //! @brief The grid of closest free spaces.
+    std::unique_ptr<closest_space_grid> m_grid;
+};
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief The state of group movement of the network of a node (referenced from its storage on first access).
+template <typename node_t>
+walk_state& walk_state_of(node_t& node) {
+    network_ref<walk_state>& r = node.storage(tags::shared_walk{});
+    if (not r) r = network_ref<walk_state>::of(&node.net);
+    return *r;
+}
+
+//! @brief The closest free space to a position, looked up in a grid of the network (shared with other simulations with the same navigator through its cache on disk).
+template <typename node_t>
+vec<2> closest_space(node_t& node, vec<2> p) {
+    return walk_state_of(node).grid(node)(p, [&](vec<2> q){
+        return node.net.closest_space(q);
+    });
 }
 
 //! @brief Reaches a target position following streets.
 FUN real_t reach_on_streets(ARGS, vec<2> target, real_t max_v, times_t period) { CODE
+    PROFILE("reach_on_streets");
     constexpr real_t k = 0.75;
     vec<2> v = old(CALL, make_vec(0,0), [&](vec<2> ov){
         return k*ov + node.position() - old(CALL, node.position());
     }) * (1-k);
-    target = node.net.closest_space(target);
-    vec<2> t = node.net.path_to(node.position(), target);
+    // street route cached across rounds: target in the previous round, its closest free space and next waypoint
+    constexpr real_t inf = std::numeric_limits<real_t>::infinity();
+    using route_t = tuple<vec<2>, vec<2>, vec<2>>;
+    route_t route = old(CALL, route_t{make_vec(inf, inf), make_vec(inf, inf), make_vec(inf, inf)}, [&](route_t r){
+        vec<2> w = get<2>(r);
+        // re-plan if the target jumped by more than a step, the waypoint has been reached or no waypoint is known
+        if (target - get<0>(r) > max_v * period or node.position() - w < 0.01 or not (std::isfinite(w[0]) and std::isfinite(w[1]))) {
+            get<1>(r) = closest_space(node, target);
+            get<2>(r) = node.net.path_to(node.position(), get<1>(r));
+        }
+        get<0>(r) = target;
+        return r;
+    });
+    target = get<1>(route);
+    vec<2> t = get<2>(route);
     if (isnan(t[0]) or isnan(t[1]))
         t = target;
     if (target[0] < 0 or target[1] < 0 or target[0] > hi_x or target[1] > hi_y)
         t = target;
     if (node.position() - t < 0.01)
         t = target;
-    if (time_since(CALL, v < 0.1) < 10 and node.current_time() > 50)
+    if (time_since(CALL, v < 0.1) < 10 and node.current_time() + common::get_or<tags::warmup>(node.storage_tuple(), times_t(0)) > 50)
         t = target;
     return follow_target(CALL, t, max_v, period);
 }
-FUN_EXPORT reach_on_streets_t = export_list<vec<2>, time_since_t>;
+FUN_EXPORT reach_on_streets_t = export_list<vec<2>, tuple<vec<2>, vec<2>, vec<2>>, time_since_t>;
+
+/**
+ * @brief A random target in a rectangle.
+ *
+ * With FCPP_DETERMINISTIC, the target is drawn from a counter-based stream keyed
+ * by the stream key and identifier of the device and by the number of targets it
+ * drew before (kept in storage, so that it is shared by every call site), so that
+ * it does not depend on the order in which threads execute rounds.
+ */
+FUN vec<2> rectangle_target(ARGS, vec<2> low, vec<2> hi) { CODE
+#if FCPP_DETERMINISTIC
+    uint64_t& round = node.storage(tags::target_round{});
+    uint64_t key = details::mix(node.storage(tags::stream{}), node.uid);
+    vec<2> t = make_vec(
+        low[0] + (hi[0] - low[0]) * details::stream_real(key, 2 * round),
+        low[1] + (hi[1] - low[1]) * details::stream_real(key, 2 * round + 1)
+    );
+    ++round;
+    return t;
+#else
+    return random_rectangle_target(CALL, low, hi);
+#endif
+}
+#if FCPP_DETERMINISTIC
+//! @brief Export list for rectangle_target.
+FUN_EXPORT rectangle_target_t = export_list<>;
+#else
+//! @brief Export list for rectangle_target.
+FUN_EXPORT rectangle_target_t = export_list<rectangle_walk_t<2>>;
+#endif
 
 //! @brief Regulates random movement in groups.
 FUN void group_walk(ARGS) { CODE
+    PROFILE("group_walk");
     using namespace tags;
 
     vec<2> low = {0, 0};
     vec<2> hi = {hi_x, hi_y};
     times_t period = 1;
-    device_t leader = node.uid - (node.uid % max_group_size);
+    group_t group_id = node.storage(group{});
+    device_t leader_id = node.storage(leader{});
     real_t max_v = node.storage(speed{});
     real_t radius = node.storage(offset{});
     bool first_round = old(CALL, true, false);
-    if (node.uid == leader) {
+    leader_snapshot& snap = walk_state_of(node).snapshot;
+    if (node.uid == leader_id) {
         if (first_round)
-            node.position() = node.net.closest_space(node.position());
+            node.position() = closest_space(node, node.position());
         // leaders just walk randomly
-        vec<2> target = random_rectangle_target(CALL, low, hi);
+        vec<2> target = rectangle_target(CALL, low, hi);
         old(CALL, target, [&](vec<2> t){
             real_t dist = reach_on_streets(CALL, t, max_v, period);
             return dist > max_v * period ? t : target;
         });
+        // publish the leader state for followers
+        snap.publish(group_id, node.position(), node.velocity(), node.current_time());
     } else {
-        // followers chase the leader up to an offset
-        vec<2> t = random_rectangle_target(CALL, make_vec(-radius, -radius), make_vec(radius, radius));
-        t = constant(CALL, t) + node.net.node_at(leader).position();
+        // followers chase the leader up to an offset, read from the snapshot of a recent leader round
+        vec<2> lp;
+        if (not snap.read(group_id, node.current_time() - 2 * period, node.current_time(), lp))
+            lp = node.net.node_at(leader_id).position();
+        vec<2> t = rectangle_target(CALL, make_vec(-radius, -radius), make_vec(radius, radius));
+        t = constant(CALL, t) + lp;
         auto fit_bounds = [](real_t v, real_t mx){
             return max(real_t(0), min(v, mx));
         };
         t = make_vec(fit_bounds(t[0], hi_x), fit_bounds(t[1], hi_y));
         if (first_round)
-            node.position() = node.net.closest_space(t); // on the first simulated round
+            node.position() = closest_space(node, t); // on the first simulated round
         else
             reach_on_streets(CALL, t, max_v, period); // on following rounds
     }
 }
 //! @brief Export types used by the group_walk function.
-FUN_EXPORT group_walk_t = export_list<rectangle_walk_t<2>, constant_t<vec<2>>, reach_on_streets_t, bool>;
+FUN_EXPORT group_walk_t = export_list<rectangle_target_t, constant_t<vec<2>>, reach_on_streets_t, bool>;
 
-//! @brief Executes a program independently in a partition of the network based on the value of a given key.
+/**
+ * @brief Executes a program independently in a partition of the network based on the value of a given key.
+ *
+ * The key is pushed to the stack trace, so that a device only exports values
+ * for its own partition, and neighbours in other partitions are not aligned
+ * (being left out of every field in the program).
+ */
 GEN(T, G) auto split(ARGS, T&& key, G&& f) { CODE
     internal::trace_key trace_process(node.stack_trace, key);
     return f();
@@ -126,20 +289,32 @@ namespace option {
     template <>
     struct option_assert<true> {};
 
-    //! @brief Option generating a group of nodes moving together.
-    template <int group_id, int group_size, int group_radius, int group_speed = 0, int start_time = 0, int x_pos = -1, int y_pos = -1>
-    DECLARE_OPTIONS(spawn_group,
-        option_assert<group_id >= 0>, // group ID should be positive
-        option_assert<0 < group_size and group_size < max_group_size>, // group size allowed between 1 and 99
+    /**
+     * @brief Option generating a group of nodes moving together, with speed and radius scaled.
+     *
+     * The speed and radius of the group are multiplied by values of the distributions S and R,
+     * and the further tags and distributions Ts are initialised in every node of the group.
+     */
+    template <typename S, typename R, int group_id, int group_size, int group_radius, int group_speed, int start_time, int x_pos, int y_pos, typename... Ts>
+    DECLARE_OPTIONS(scaled_group,
+        option_assert<0 <= group_id and group_id < 256>, // group ID between 0 and 255 (higher ones are for groups read from files)
+        option_assert<0 < group_size and group_size <= max_group_size>, // group size allowed between 1 and max_group_size
         // group_size spawn events all at start_time
         spawn_schedule<sequence::multiple_n<group_size, start_time>>,
         init<
             uid,    arithmetic_sequence<device_t, max_group_size * group_id, 1>, // arithmetic sequence of device IDs
-	    x,      std::conditional_t<x_pos == -1, rectangle_d, distribution::point_n<1,x_pos,y_pos>>, // random displacement of devices in the simulation area
-            speed,  distribution::constant_n<double, group_speed * 1000, 3600>, // store the group speed, converting from km/h to m/s
-            offset, distribution::constant_n<double, group_radius> // store the group radius
+            x,      std::conditional_t<x_pos == -1, rectangle_d, distribution::point_n<1,x_pos,y_pos>>, // random displacement of devices in the simulation area
+            speed,  functor::mul<distribution::constant_n<double, group_speed * 1000, 3600>, S>, // store the scaled group speed, converting from km/h to m/s
+            offset, functor::mul<distribution::constant_n<double, group_radius>, R>, // store the scaled group radius
+            group,  distribution::constant_n<group_t, group_id>, // store the group
+            leader, distribution::constant_n<device_t, max_group_size * group_id>, // the first device of the group leads it
+            Ts...
         >
     );
+
+    //! @brief Option generating a group of nodes moving together.
+    template <int group_id, int group_size, int group_radius, int group_speed = 0, int start_time = 0, int x_pos = -1, int y_pos = -1>
+    using spawn_group = scaled_group<distribution::constant_n<double, 1>, distribution::constant_n<double, 1>, group_id, group_size, group_radius, group_speed, start_time, x_pos, y_pos>;
 }
 
 }
@@ -0,0 +1,326 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file navigation.hpp
+ * @brief Implementation of data structures speeding up navigation queries on the map and among nodes.
+ */
+
+#ifndef FCPP_NAVIGATION_H_
+#define FCPP_NAVIGATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "lib/fcpp.hpp"
+#include "lib/slots.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Grid of the closest free spaces to every unit cell of a map.
+ *
+ * Cells are filled on first access through a navigator query, and are safe
+ * to be concurrently accessed: every cell is computed at most once, after
+ * which lookups take constant time. The grid can be backed by a cache file
+ * next to the obstacles image, which is memory-mapped (where supported) so
+ * that cells computed in previous runs are loaded without copies. The file
+ * is keyed by the content of the image and by a key of the navigator in use
+ * (so that different navigators never share it), and stale files are replaced
+ * atomically (so that other processes mapping them are not affected). Only
+ * closest free spaces are cached: the navigation graph is still built by the
+ * navigator in every run.
+ */
+class closest_space_grid {
+  public:
+    //! @brief Constructor given the size of the map (in memory).
+    closest_space_grid(size_t width, size_t height) : m_width(width), m_height(height), m_owned(new std::atomic<uint64_t>[width * height]()) {
+        m_cells = m_owned.get();
+    }
+
+    //! @brief Constructor given the size of the map, and the obstacles image and the navigator key keying the cache file.
+    closest_space_grid(size_t width, size_t height, std::string const& image, uint64_t key) : closest_space_grid(width, height) {
+        map_cache(image, key);
+    }
+
+    //! @brief Copies are not allowed.
+    closest_space_grid(closest_space_grid const&) = delete;
+
+    //! @brief Destructor (unmapping the cache file).
+    ~closest_space_grid() {
+#ifndef _WIN32
+        if (m_mapped != nullptr)
+            munmap(m_mapped, m_mapped_size);
+#endif
+    }
+
+    //! @brief Width of the map.
+    size_t width() const {
+        return m_width;
+    }
+
+    //! @brief Height of the map.
+    size_t height() const {
+        return m_height;
+    }
+
+    /**
+     * @brief The closest free space to a position, given a function computing it.
+     *
+     * A cell is computed once from its centre, assuming obstacles made of whole
+     * cells (as pixels of an obstacles image of the size of the map). Positions in
+     * free cells are free, and answered exactly. Positions in other cells are
+     * answered by the closest free space to the centre, moved by the offset of the
+     * position from the centre: this is a free space if it falls in a cell known to
+     * be free, otherwise the exact query is made (and not cached). Answers moved by
+     * the offset are approximate: they are free spaces at most half a cell diagonal
+     * (about 0.71 units) farther from the position than the exact closest free space,
+     * as the distance from free spaces changes by at most the distance between the
+     * position and the centre.
+     */
+    template <typename F>
+    vec<2> operator()(vec<2> p, F&& closest_space) {
+        if (not inside(p))
+            return closest_space(p);
+        vec<2> c = make_vec(size_t(p[0]) + 0.5, size_t(p[1]) + 0.5);
+        std::atomic<uint64_t>& cell = at(p);
+        uint64_t v = cell.load(std::memory_order_relaxed);
+        if (v == unknown) {
+            vec<2> r = closest_space(c);
+            v = c - r < 0.01 ? free_cell : encode(r);
+            cell.store(v, std::memory_order_relaxed);
+        }
+        if (v == free_cell)
+            return p;
+        vec<2> r = decode(v);
+        vec<2> q = r + (p - c);
+        return inside(q) and at(q).load(std::memory_order_relaxed) == free_cell ? q : closest_space(p);
+    }
+
+    //! @brief Whether the grid is backed by a cache file.
+    bool cached() const {
+        return m_owned == nullptr;
+    }
+
+  protected:
+    //! @brief Encoding of a cell that has not been computed yet.
+    static constexpr uint64_t unknown = 0;
+    //! @brief Encoding of a free cell (known bit and sign bit of the second coordinate).
+    static constexpr uint64_t free_cell = (uint64_t(1) << 63) | (uint64_t(1) << 31);
+
+    //! @brief Encodes a non-negative position as two floats, setting the known bit (sign of the first coordinate).
+    static uint64_t encode(vec<2> p) {
+        float x = max(p[0], real_t(0)), y = max(p[1], real_t(0));
+        uint32_t bx, by;
+        std::memcpy(&bx, &x, sizeof(float));
+        std::memcpy(&by, &y, sizeof(float));
+        return (uint64_t(1) << 63) | (uint64_t(bx) << 32) | by;
+    }
+
+    //! @brief Decodes a position from two floats, ignoring the known bit.
+    static vec<2> decode(uint64_t v) {
+        uint32_t bx = (v >> 32) & 0x7FFFFFFF, by = v & 0xFFFFFFFF;
+        float x, y;
+        std::memcpy(&x, &bx, sizeof(float));
+        std::memcpy(&y, &by, sizeof(float));
+        return make_vec(x, y);
+    }
+
+  private:
+    //! @brief Whether a position is within the map.
+    bool inside(vec<2> p) const {
+        return p[0] >= 0 and p[1] >= 0 and p[0] < m_width and p[1] < m_height;
+    }
+
+    //! @brief The cell of a position within the map.
+    std::atomic<uint64_t>& at(vec<2> p) const {
+        return m_cells[size_t(p[1]) * m_width + size_t(p[0])];
+    }
+
+    //! @brief Header of the cache file.
+    struct header {
+        //! @brief Identifier of the file format.
+        char magic[8];
+        //! @brief Width of the map.
+        uint64_t width;
+        //! @brief Height of the map.
+        uint64_t height;
+        //! @brief Hash of the obstacles image.
+        uint64_t hash;
+        //! @brief Key of the navigator.
+        uint64_t key;
+    };
+
+    //! @brief FNV-1a hash of the content of a file (zero if it cannot be read).
+    static uint64_t file_hash(std::string const& file) {
+        std::ifstream in(file, std::ios::binary);
+        if (not in) return 0;
+        uint64_t h = 14695981039346656037ULL;
+        for (std::istreambuf_iterator<char> it(in), end; it != end; ++it)
+            h = (h ^ uint8_t(*it)) * 1099511628211ULL;
+        return h;
+    }
+
+    //! @brief Maps the cache file of an obstacles image and navigator (leaving the grid in memory on failure).
+    void map_cache(std::string const& image, uint64_t key) {
+#ifndef _WIN32
+        if (image.empty()) return;
+        // the image is looked for as given, or in the textures folder
+        std::string path;
+        uint64_t hash = 0;
+        for (std::string prefix : {"", "textures/", "../textures/"})
+            if ((hash = file_hash(prefix + image)) != 0) {
+                path = prefix + image;
+                break;
+            }
+        if (hash == 0) return;
+        char name[32];
+        std::snprintf(name, sizeof(name), ".%016llx.cache", (unsigned long long)key);
+        path += name;
+        header h = {{'F','C','P','P','N','A','V','2'}, m_width, m_height, hash, key};
+        size_t size = sizeof(header) + m_width * m_height * sizeof(uint64_t);
+        int fd = open(path.c_str(), O_RDWR);
+        if (fd >= 0) {
+            struct stat st;
+            header old;
+            bool valid = fstat(fd, &st) == 0 and size_t(st.st_size) == size;
+            valid = valid and pread(fd, &old, sizeof(header), 0) == sizeof(header) and std::memcmp(&old, &h, sizeof(header)) == 0;
+            if (not valid) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        if (fd < 0) {
+            // stale or missing cache: a new file with every cell unknown replaces it atomically,
+            // so that processes mapping the old file keep reading it (instead of being truncated)
+            std::string temp = path + "." + std::to_string(getpid()) + ".tmp";
+            fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) return;
+            if (ftruncate(fd, size) != 0 or pwrite(fd, &h, sizeof(header), 0) != sizeof(header) or rename(temp.c_str(), path.c_str()) != 0) {
+                close(fd);
+                unlink(temp.c_str());
+                return;
+            }
+        }
+        void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) return;
+        m_mapped = m;
+        m_mapped_size = size;
+        m_cells = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(m) + sizeof(header));
+        m_owned.reset();
+#endif
+    }
+
+    //! @brief Width of the map.
+    size_t m_width;
+    //! @brief Height of the map.
+    size_t m_height;
+    //! @brief Cells allocated in memory (if not backed by a cache file).
+    std::unique_ptr<std::atomic<uint64_t>[]> m_owned;
+    //! @brief Memory mapping of the cache file.
+    void* m_mapped = nullptr;
+    //! @brief Size of the memory mapping of the cache file.
+    size_t m_mapped_size = 0;
+    //! @brief Encoding of the closest free space for every cell.
+    std::atomic<uint64_t>* m_cells;
+};
+
+
+/**
+ * @brief Snapshot of the positions of group leaders, published in their rounds for followers to read.
+ *
+ * Slots are stored contiguously in chunks (see lib/slots.hpp), each updated by its leader only,
+ * so that followers do not need to access the state of other nodes. Slots are
+ * guarded by a sequence lock, so that followers never mix the fields of two
+ * publications (retrying a read overlapping a publication instead). Every slot
+ * fills a cache line, so that leaders publishing from different threads do not
+ * invalidate each other's lines, while followers only read their leader's one.
+ * The snapshot of a network is held once in its `walk_state` (see lib/movement.hpp).
+ */
+class leader_snapshot {
+    //! @brief Slot holding the state of a leader (defined below).
+    struct slot;
+
+  public:
+    //! @brief Maximum number of groups.
+    static constexpr size_t max_groups = group_slots<slot>::max_groups;
+
+    //! @brief Publishes the position and velocity of the leader of a group at a given time.
+    void publish(size_t group, vec<2> position, vec<2> velocity, times_t time) {
+        slot& s = m_slots.get(group);
+        // odd versions mark a publication in progress
+        uint64_t v = s.version.load(std::memory_order_relaxed);
+        s.version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.time.store(time, std::memory_order_relaxed);
+        s.x.store(position[0], std::memory_order_relaxed);
+        s.y.store(position[1], std::memory_order_relaxed);
+        s.vx.store(velocity[0], std::memory_order_relaxed);
+        s.vy.store(velocity[1], std::memory_order_relaxed);
+        s.version.store(v + 2, std::memory_order_release);
+    }
+
+    //! @brief Reads the position of the leader of a group at a given time, if published in a given time interval.
+    bool read(size_t group, times_t after, times_t now, vec<2>& position) {
+        slot& s = m_slots.get(group);
+        times_t t = -1;
+        vec<2> p, v;
+        // retry until the fields read all come from the same complete publication
+        uint64_t v1, v2;
+        do {
+            v1 = s.version.load(std::memory_order_acquire);
+            t = s.time.load(std::memory_order_relaxed);
+            p = make_vec(s.x.load(std::memory_order_relaxed), s.y.load(std::memory_order_relaxed));
+            v = make_vec(s.vx.load(std::memory_order_relaxed), s.vy.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            v2 = s.version.load(std::memory_order_relaxed);
+        } while ((v1 & 1) or v1 != v2);
+        // slots published in the future come from a previous simulation
+        if (not (after <= t and t <= now))
+            return false;
+        position = p + v * (now - t);
+        return true;
+    }
+
+  private:
+    //! @brief Slot holding the state of a leader (on its own cache line, as leaders run on different threads).
+    struct alignas(64) slot {
+        //! @brief Version of the slot, odd while a publication is in progress.
+        std::atomic<uint64_t> version{0};
+        //! @brief Time of publication.
+        std::atomic<times_t> time{-1};
+        //! @brief First coordinate of the position.
+        std::atomic<real_t> x{0};
+        //! @brief Second coordinate of the position.
+        std::atomic<real_t> y{0};
+        //! @brief First coordinate of the velocity.
+        std::atomic<real_t> vx{0};
+        //! @brief Second coordinate of the velocity.
+        std::atomic<real_t> vy{0};
+    };
+
+    //! @brief Slots of the leaders.
+    group_slots<slot> m_slots;
+};
+
+}
+
+#endif // FCPP_NAVIGATION_H_
@@ -10,6 +10,8 @@
 
 #include "lib/beautify.hpp"
 #include "lib/coordination/utils.hpp"
+#include "lib/counting.hpp"
+#include "lib/profiler.hpp"
 
 
 /**
@@ -20,29 +22,58 @@ namespace fcpp {
 //! @brief Namespace containing the libraries of coordination routines.
 namespace coordination {
 
+//! @brief Truth values of a set of formulas, one per bit.
+using formula_mask = uint64_t;
+
 //! @brief Exports for Past-CTL logic formulas.
-using past_ctl_t = export_list<bool>;
+using past_ctl_t = export_list<bool, formula_mask, times_t>;
+
+/**
+ * @brief Description of a set of Past-CTL formulas evaluated together, one per bit.
+ *
+ * Every formula is either of the yesterday kind (with value of `f2` in the previous round)
+ * or of the since kind (with value `f2 | (f1 & previous value)`), where the previous value
+ * is taken in the same device, in all devices or in any device. The operators correspond to:
+ * - `Y`, `AY`, `EY`: yesterday kind, initially false, true, false;
+ * - `S`, `AS`, `ES`: since kind, initially false;
+ * - `P`, `AP`, `EP`: since kind with `f1` true, initially false;
+ * - `H`, `AH`, `EH`: since kind with `f1` as argument and `f2` false, initially true.
+ */
+struct packed_formulas {
+    //! @brief Formulas of the since kind (the others being of the yesterday kind).
+    formula_mask since;
+    //! @brief Formulas evaluated in all devices.
+    formula_mask all;
+    //! @brief Formulas evaluated in any device.
+    formula_mask any;
+    //! @brief Initial values of the formulas.
+    formula_mask init;
+};
 
 //! @brief Namespace containing logical operators and formulas.
 namespace logic {
 
 //! @brief Yesterday in the same device.
 FUN bool Y(ARGS, bool f) { CODE
+    PROFILE("logic::Y");
     return old(CALL, false, f);
 }
 
 //! @brief Yesterday in all devices.
 FUN bool AY(ARGS, bool f) { CODE
-    return all_hood(CALL, nbr(CALL, true, f));
+    PROFILE("logic::AY");
+    return all_true(CALL, nbr(CALL, true, f));
 }
 
 //! @brief Yesterday in some device.
 FUN bool EY(ARGS, bool f) { CODE
-    return any_hood(CALL, nbr(CALL, false, f));
+    PROFILE("logic::EY");
+    return any_true(CALL, nbr(CALL, false, f));
 }
 
 //! @brief f1 holds since f2 held in the same device.
 FUN bool S(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::S");
     return old(CALL, false, [&](bool o) -> bool {
         return f2 | (f1 & o);
     });
@@ -50,20 +81,23 @@ FUN bool S(ARGS, bool f1, bool f2) { CODE
 
 //! @brief f1 holds since f2 held in all devices.
 FUN bool AS(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::AS");
     return nbr(CALL, false, [&](field<bool> n) -> bool {
-        return f2 | (f1 & all_hood(CALL, n));
+        return f2 | (f1 & all_true(CALL, n));
     });
 }
 
 //! @brief f1 holds since f2 held in any device.
 FUN bool ES(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::ES");
     return nbr(CALL, false, [&](field<bool> n) -> bool {
-        return f2 | (f1 & any_hood(CALL, n));
+        return f2 | (f1 & any_true(CALL, n));
     });
 }
 
 //! @brief Previously in the same device.
 FUN bool P(ARGS, bool f) { CODE
+    PROFILE("logic::P");
     return old(CALL, false, [&](bool o) -> bool {
         return f | o;
     });
@@ -71,20 +105,23 @@ FUN bool P(ARGS, bool f) { CODE
 
 //! @brief Previously in all devices.
 FUN bool AP(ARGS, bool f) { CODE
+    PROFILE("logic::AP");
     return nbr(CALL, false, [&](field<bool> n) -> bool {
-        return f | all_hood(CALL, n);
+        return f | all_true(CALL, n);
     });
 }
 
 //! @brief Previously in any device.
 FUN bool EP(ARGS, bool f) { CODE
+    PROFILE("logic::EP");
     return nbr(CALL, false, [&](field<bool> n) -> bool {
-        return f | any_hood(CALL, n);
+        return f | any_true(CALL, n);
     });
 }
 
 //! @brief Historically in the same device.
 FUN bool H(ARGS, bool f) { CODE
+    PROFILE("logic::H");
     return old(CALL, true, [&](bool o) -> bool {
         return f & o;
     });
@@ -92,16 +129,96 @@ FUN bool H(ARGS, bool f) { CODE
 
 //! @brief Historically in all devices.
 FUN bool AH(ARGS, bool f) { CODE
+    PROFILE("logic::AH");
     return nbr(CALL, true, [&](field<bool> n) -> bool {
-        return f & all_hood(CALL, n);
+        return f & all_true(CALL, n);
     });
 }
 
 //! @brief Historically in any device.
 FUN bool EH(ARGS, bool f) { CODE
+    PROFILE("logic::EH");
     return nbr(CALL, true, [&](field<bool> n) -> bool {
-        return f & any_hood(CALL, n);
+        return f & any_true(CALL, n);
+    });
+}
+
+// Time-bounded operators, holding if the unbounded version holds through an event in the last t seconds.
+// Each keeps a single timestamp (of the latest event supporting the formula) instead of a chain of
+// previous values, so that its state and export size do not depend on t.
+
+//! @brief f1 holds since f2 held in the same device, in the last t seconds.
+FUN bool S_within(ARGS, bool f1, bool f2, times_t t) { CODE
+    PROFILE("logic::S_within");
+    times_t now = node.current_time();
+    return now - old(CALL, -TIME_MAX, [&](times_t o) -> times_t {
+        return f2 ? now : f1 ? o : -TIME_MAX;
+    }) <= t;
+}
+
+//! @brief f1 holds since f2 held in all devices, in the last t seconds.
+FUN bool AS_within(ARGS, bool f1, bool f2, times_t t) { CODE
+    PROFILE("logic::AS_within");
+    times_t now = node.current_time();
+    return now - nbr(CALL, -TIME_MAX, [&](field<times_t> n) -> times_t {
+        return f2 ? now : f1 ? min_hood(CALL, n) : -TIME_MAX;
+    }) <= t;
+}
+
+//! @brief f1 holds since f2 held in any device, in the last t seconds.
+FUN bool ES_within(ARGS, bool f1, bool f2, times_t t) { CODE
+    PROFILE("logic::ES_within");
+    times_t now = node.current_time();
+    return now - nbr(CALL, -TIME_MAX, [&](field<times_t> n) -> times_t {
+        return f2 ? now : f1 ? max_hood(CALL, n) : -TIME_MAX;
+    }) <= t;
+}
+
+//! @brief Previously in the same device, in the last t seconds.
+FUN bool P_within(ARGS, bool f, times_t t) { CODE
+    return S_within(CALL, true, f, t);
+}
+
+//! @brief Previously in all devices, in the last t seconds.
+FUN bool AP_within(ARGS, bool f, times_t t) { CODE
+    return AS_within(CALL, true, f, t);
+}
+
+//! @brief Previously in any device, in the last t seconds.
+FUN bool EP_within(ARGS, bool f, times_t t) { CODE
+    return ES_within(CALL, true, f, t);
+}
+
+//! @brief Historically in the same device, in the last t seconds.
+FUN bool H_within(ARGS, bool f, times_t t) { CODE
+    return not P_within(CALL, not f, t);
+}
+
+//! @brief Historically in all devices, in the last t seconds.
+FUN bool AH_within(ARGS, bool f, times_t t) { CODE
+    return not EP_within(CALL, not f, t);
+}
+
+//! @brief Historically in any device, in the last t seconds.
+FUN bool EH_within(ARGS, bool f, times_t t) { CODE
+    return not AP_within(CALL, not f, t);
+}
+
+//! @brief Evaluates up to 64 Past-CTL formulas at once, sharing a single export.
+FUN formula_mask packed(ARGS, formula_mask f1, formula_mask f2, packed_formulas const& p) { CODE
+    PROFILE("logic::packed");
+    formula_mask spatial = p.all | p.any;
+    formula_mask r;
+    nbr(CALL, p.init, [&](field<formula_mask> n) -> formula_mask {
+        // word-wide conjunction on all-bits and disjunction on any-bits
+        formula_mask x = fold_hood(CALL, [&](formula_mask a, formula_mask b) -> formula_mask {
+            return ((a | b) & p.any) | (a & b & ~p.any);
+        }, n);
+        x = (x & spatial) | (self(CALL, n) & ~spatial);
+        r = (x & ~p.since) | ((f2 | (f1 & x)) & p.since);
+        return (f2 & ~p.since) | (r & p.since);
     });
+    return r;
 }
 
 }
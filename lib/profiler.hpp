@@ -0,0 +1,222 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file profiler.hpp
+ * @brief Implementation of an opt-in profiler of aggregate functions.
+ */
+
+#ifndef FCPP_PROFILER_H_
+#define FCPP_PROFILER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! @brief Whether aggregate functions are profiled.
+#ifndef FCPP_PROFILE
+#define FCPP_PROFILE false
+#endif
+
+#if FCPP_PROFILE
+//! @brief Profiles the remainder of the current function body under a given name.
+#define PROFILE(name)                                                   \
+    static size_t const fcpp_profile_id = fcpp::profiler::id(name);     \
+    fcpp::profiler::scope fcpp_profile_scope(fcpp_profile_id)
+//! @brief Stores in a tag the microseconds elapsed in the profiled function body since the previous lap.
+#define PROFILE_LAP(tag)    node.storage(tag{}) = fcpp_profile_scope.lap()
+#else
+//! @brief Profiles the remainder of the current function body under a given name (disabled).
+#define PROFILE(name)
+//! @brief Stores in a tag the microseconds elapsed in the profiled function body since the previous lap (disabled).
+#define PROFILE_LAP(tag)
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Profiler of call counts and cumulative time of named code sections.
+ *
+ * Statistics are collected in thread-local slots, so that profiled sections
+ * do not contend with each other. The time of a section is inclusive of the
+ * sections nested in it (so that times of nested sections add up to more than
+ * the time elapsed), while its self time excludes them.
+ */
+class profiler {
+  public:
+    //! @brief Maximum number of profiled sections.
+    static constexpr size_t max_sections = 256;
+
+    //! @brief Statistics of a section in a thread.
+    struct stat {
+        //! @brief Number of calls.
+        std::atomic<uint64_t> calls{0};
+        //! @brief Cumulative time in nanoseconds.
+        std::atomic<uint64_t> time{0};
+        //! @brief Cumulative time in nanoseconds, excluding nested sections.
+        std::atomic<uint64_t> self{0};
+    };
+
+    //! @brief Measures the time spent in a section until destruction.
+    class scope {
+      public:
+        //! @brief Constructor given the section identifier.
+        scope(size_t id) : m_id(id), m_start(std::chrono::steady_clock::now()), m_lap(m_start), m_parent(current()) {
+            current() = this;
+        }
+
+        //! @brief Microseconds elapsed since the previous lap (or the start).
+        double lap() {
+            auto t = std::chrono::steady_clock::now();
+            double d = std::chrono::duration<double, std::micro>(t - m_lap).count();
+            m_lap = t;
+            return d;
+        }
+
+        //! @brief Destructor, accounting for the time spent.
+        ~scope() {
+            stat& s = local()[m_id];
+            uint64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+            s.calls.fetch_add(1, std::memory_order_relaxed);
+            s.time.fetch_add(t, std::memory_order_relaxed);
+            s.self.fetch_add(t - std::min(t, m_nested), std::memory_order_relaxed);
+            if (m_parent != nullptr) m_parent->m_nested += t;
+            current() = m_parent;
+        }
+
+      private:
+        //! @brief The section identifier.
+        size_t m_id;
+        //! @brief The start time.
+        std::chrono::steady_clock::time_point m_start;
+        //! @brief The time of the previous lap.
+        std::chrono::steady_clock::time_point m_lap;
+        //! @brief The enclosing scope in the current thread.
+        scope* m_parent;
+        //! @brief The time in nanoseconds spent in nested scopes.
+        uint64_t m_nested = 0;
+
+        //! @brief The innermost scope in the current thread.
+        static scope*& current() {
+            thread_local scope* s = nullptr;
+            return s;
+        }
+    };
+
+    //! @brief The identifier of a section given its name (registering it on first call).
+    static size_t id(std::string const& name) {
+        std::lock_guard<std::mutex> l(registry().lock);
+        auto it = registry().ids.find(name);
+        if (it != registry().ids.end()) return it->second;
+        size_t i = registry().names.size();
+        assert(i < max_sections);
+        registry().names.push_back(name);
+        registry().ids[name] = i;
+        return i;
+    }
+
+    //! @brief Total number of calls of a section across threads.
+    static uint64_t calls(size_t id) {
+        return total(id, &stat::calls);
+    }
+
+    //! @brief Total time in seconds spent in a section across threads.
+    static double time(size_t id) {
+        return total(id, &stat::time) * 1e-9;
+    }
+
+    //! @brief Total time in seconds spent in a section across threads, excluding nested sections.
+    static double self_time(size_t id) {
+        return total(id, &stat::self) * 1e-9;
+    }
+
+    //! @brief Prints a table of statistics for every section, by decreasing time.
+    static void report(std::ostream& o) {
+        std::vector<size_t> ids;
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> l(registry().lock);
+            names = registry().names;
+        }
+        for (size_t i = 0; i < names.size(); ++i)
+            ids.push_back(i);
+        std::vector<double> times;
+        for (size_t i : ids) times.push_back(time(i));
+        std::ios_base::fmtflags flags = o.flags();
+        std::streamsize precision = o.precision();
+        std::sort(ids.begin(), ids.end(), [&](size_t i, size_t j){
+            return times[i] > times[j];
+        });
+        o << std::left << std::setw(24) << "function" << std::right << std::setw(14) << "calls" << std::setw(14) << "time (s)" << std::setw(14) << "self (s)" << std::setw(14) << "us/call" << "\n";
+        for (size_t i : ids) {
+            uint64_t c = calls(i);
+            o << std::left << std::setw(24) << names[i] << std::right << std::setw(14) << c << std::setw(14) << std::fixed << std::setprecision(3) << times[i] << std::setw(14) << self_time(i) << std::setw(14) << (c ? times[i] * 1e6 / c : 0) << "\n";
+        }
+        o.flags(flags);
+        o.precision(precision);
+        o << std::flush;
+    }
+
+    //! @brief Prints a table of statistics if some seconds have passed since the previous one (from a single thread).
+    static void report_every(std::ostream& o, double seconds) {
+        static std::atomic<int64_t> next{0};
+        int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t n = next.load(std::memory_order_relaxed);
+        if (now >= n and next.compare_exchange_strong(n, now + int64_t(seconds * 1000)))
+            report(o);
+    }
+
+  private:
+    //! @brief Global registry of sections and thread slots.
+    struct registry_t {
+        //! @brief Lock guarding the registry.
+        std::mutex lock;
+        //! @brief Identifiers of sections by name.
+        std::unordered_map<std::string, size_t> ids;
+        //! @brief Names of sections by identifier.
+        std::vector<std::string> names;
+        //! @brief Slots of every thread (never deallocated, as they may outlive their thread in reports).
+        std::vector<stat*> threads;
+    };
+
+    //! @brief Access to the global registry.
+    static registry_t& registry() {
+        static registry_t r;
+        return r;
+    }
+
+    //! @brief Access to the slots of the current thread.
+    static stat* local() {
+        thread_local stat* slots = [](){
+            stat* s = new stat[max_sections];
+            std::lock_guard<std::mutex> l(registry().lock);
+            registry().threads.push_back(s);
+            return s;
+        }();
+        return slots;
+    }
+
+    //! @brief Sums a statistic of a section across threads.
+    static uint64_t total(size_t id, std::atomic<uint64_t> stat::* field) {
+        std::lock_guard<std::mutex> l(registry().lock);
+        uint64_t t = 0;
+        for (stat* s : registry().threads)
+            t += (s[id].*field).load(std::memory_order_relaxed);
+        return t;
+    }
+};
+
+}
+
+#endif // FCPP_PROFILER_H_
@@ -0,0 +1,87 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file quiescence.hpp
+ * @brief Implementation of the detection of quiescent devices, whose rounds can be stretched.
+ */
+
+#ifndef FCPP_QUIESCENCE_H_
+#define FCPP_QUIESCENCE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "lib/beautify.hpp"
+#include "lib/coordination/utils.hpp"
+#include "lib/counting.hpp"
+#include "lib/random.hpp"
+
+//! @brief Whether the rounds of quiescent devices are stretched.
+#ifndef FCPP_QUIESCENCE
+#define FCPP_QUIESCENCE false
+#endif
+
+//! @brief The maximum interval between rounds of a quiescent device (below the message retain time).
+#ifndef FCPP_QUIESCENCE_STRETCH
+#define FCPP_QUIESCENCE_STRETCH 2
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+/**
+ * @brief Number of rounds in which nothing changed around the device, within as many hops.
+ *
+ * The device is locally stable if the digest of its inputs, of the identifiers of
+ * its neighbours and of their inputs is unchanged since the previous round. The
+ * inputs should digest everything the device shares that may change, including
+ * the values of its monitors (so that devices receiving changing monitor state
+ * are not stable). The count is reset on local changes, and bounded by the counts
+ * of neighbours plus one, so that a change at some hops of distance reaches the
+ * device in its count.
+ */
+FUN int quiescent_rounds(ARGS, uint64_t inputs) { CODE
+    field<uint64_t> n = nbr(CALL, inputs);
+    // digest of the aligned neighbours (and of the device itself) in a single scan
+    std::vector<device_t> const& ids = fcpp::details::get_ids(n);
+    auto const& vals = fcpp::details::get_vals(n);
+    uint64_t h = 0;
+    for (size_t j = 0; j < ids.size(); ++j)
+        h ^= details::mix(ids[j], vals[j+1]);
+    if (not std::binary_search(ids.begin(), ids.end(), node.uid))
+        h ^= details::mix(node.uid, vals[0]);
+    bool stable = old(CALL, ~h, h) == h;
+    return nbr(CALL, 0, [&](field<int> n) {
+        return stable ? min(min_hood(CALL, n) + 1, 1 << 20) : 0;
+    });
+}
+//! @brief Export list for quiescent_rounds.
+FUN_EXPORT quiescent_rounds_t = export_list<uint64_t, int>;
+
+/**
+ * @brief Stretches the next round of a device that has been quiescent for some rounds.
+ *
+ * The interval grows from the period of one second, doubling with each quiescent
+ * round from the second on (1, 2, 4... seconds), up to FCPP_QUIESCENCE_STRETCH
+ * seconds (which must stay below the retain time of messages, so that neighbours
+ * do not discard the device). Rounds resume their schedule as soon as something
+ * changes (the device noticing it in its next round).
+ */
+FUN void stretch_rounds(ARGS, int rounds) { CODE
+    if (rounds < 2) return;
+    times_t dt = min(times_t(1) * (1 << min(rounds - 2, 8)), times_t(FCPP_QUIESCENCE_STRETCH));
+    node.next_time(max(node.next_time(), node.current_time() + dt));
+}
+
+}
+
+}
+
+#endif // FCPP_QUIESCENCE_H_
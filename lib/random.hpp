@@ -0,0 +1,44 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file random.hpp
+ * @brief Implementation of counter-based random streams, independent of the order of execution.
+ */
+
+#ifndef FCPP_RANDOM_H_
+#define FCPP_RANDOM_H_
+
+#include <cstdint>
+
+#include "lib/fcpp.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Namespace of implementation details.
+namespace details {
+    //! @brief Mixes two words into a well-distributed hash (as in splitmix64).
+    inline uint64_t mix(uint64_t x, uint64_t y) {
+        uint64_t z = x * 0x9E3779B97F4A7C15ULL + y;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    //! @brief The i-th real in [0,1) of the stream with a given key.
+    inline real_t stream_real(uint64_t key, uint64_t i) {
+        return real_t(mix(key, i) >> 11) * real_t(1.0 / (uint64_t(1) << 53));
+    }
+}
+
+}
+
+}
+
+#endif // FCPP_RANDOM_H_
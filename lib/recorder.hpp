@@ -0,0 +1,227 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file recorder.hpp
+ * @brief Implementation of a flight recorder of proposition values, dumped when monitors fail.
+ */
+
+#ifndef FCPP_RECORDER_H_
+#define FCPP_RECORDER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+
+#include "lib/fcpp.hpp"
+
+//! @brief The number of rounds kept in the flight record of every node (zero to disable recording).
+#ifndef FCPP_FLIGHT_RECORDER_SIZE
+#define FCPP_FLIGHT_RECORDER_SIZE 64
+#endif
+
+//! @brief The file where flight records of failing monitors are appended.
+#ifndef FCPP_FLIGHT_RECORDER_FILE
+#define FCPP_FLIGHT_RECORDER_FILE "violations.trace"
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Ring buffer of the proposition values of a device in its last rounds, one bit each.
+ *
+ * Bit 63 holds whether the monitors held in the round, lower bits are free for propositions.
+ */
+template <size_t N>
+class flight_ring {
+  public:
+    //! @brief The bit holding whether the monitors held.
+    static constexpr size_t ok_bit = 63;
+
+    //! @brief Stages the value of a proposition for the current round.
+    void set(size_t bit, bool value) {
+        m_staged |= uint64_t(value) << bit;
+    }
+
+    //! @brief Commits the staged values at a given time, returning whether the monitors just started failing.
+    bool commit(times_t time, bool ok) {
+        m_time[m_next] = time;
+        m_bits[m_next] = m_staged | (uint64_t(ok) << ok_bit);
+        m_next = (m_next + 1) % N;
+        if (m_size < N) ++m_size;
+        m_staged = 0;
+        bool onset = m_ok and not ok;
+        m_ok = ok;
+        return onset;
+    }
+
+    //! @brief The number of rounds recorded.
+    size_t size() const {
+        return m_size;
+    }
+
+    //! @brief The time of the i-th oldest round recorded.
+    times_t time(size_t i) const {
+        return m_time[(m_next + N - m_size + i) % N];
+    }
+
+    //! @brief The values of the i-th oldest round recorded.
+    uint64_t bits(size_t i) const {
+        return m_bits[(m_next + N - m_size + i) % N];
+    }
+
+  private:
+    //! @brief Times of the rounds.
+    times_t m_time[N] = {};
+    //! @brief Values of the rounds.
+    uint64_t m_bits[N] = {};
+    //! @brief Values staged for the current round.
+    uint64_t m_staged = 0;
+    //! @brief Position of the next round to be written.
+    uint32_t m_next = 0;
+    //! @brief Number of rounds recorded.
+    uint32_t m_size = 0;
+    //! @brief Whether the monitors held in the last round.
+    bool m_ok = true;
+};
+
+//! @brief Empty flight record, with recording disabled.
+template <>
+class flight_ring<0> {
+  public:
+    //! @brief The bit holding whether the monitors held.
+    static constexpr size_t ok_bit = 63;
+
+    //! @brief Stages the value of a proposition for the current round (ignored).
+    void set(size_t, bool) {}
+
+    //! @brief Commits the staged values at a given time (ignored).
+    bool commit(times_t, bool) {
+        return false;
+    }
+
+    //! @brief The number of rounds recorded.
+    size_t size() const {
+        return 0;
+    }
+
+    //! @brief The time of the i-th oldest round recorded.
+    times_t time(size_t) const {
+        return 0;
+    }
+
+    //! @brief The values of the i-th oldest round recorded.
+    uint64_t bits(size_t) const {
+        return 0;
+    }
+};
+
+//! @brief Printing a flight record (in the user interface).
+template <size_t N>
+std::ostream& operator<<(std::ostream& o, flight_ring<N> const& r) {
+    o << r.size() << " rounds";
+    if (r.size() > 0) o << ", last " << std::hex << r.bits(r.size() - 1) << std::dec;
+    return o;
+}
+
+/**
+ * @brief Appends flight records to a binary trace file, opened on the first violation.
+ *
+ * The file starts with the magic `FCPPFLT2`, followed by records made of the device
+ * identifier (uint64), the time of the violation (float64), the number of parameters
+ * of the run (uint64) and their values (float64 each), the number of rounds (uint64),
+ * and for every round its time (float64) and values (uint64), in native byte order.
+ * Records of different runs in the same process (as in batches) are told apart by
+ * the parameters of their run.
+ */
+class flight_writer {
+  public:
+    //! @brief Appends the record of a device, in a run with given parameters.
+    template <size_t N>
+    static void dump(device_t uid, times_t now, std::initializer_list<double> run, flight_ring<N> const& r) {
+        std::lock_guard<std::mutex> l(instance().m_lock);
+        std::FILE* f = instance().file();
+        if (f == nullptr) return;
+        uint64_t id = uid, p = run.size(), n = r.size();
+        double t = now;
+        std::fwrite(&id, sizeof(id), 1, f);
+        std::fwrite(&t, sizeof(t), 1, f);
+        std::fwrite(&p, sizeof(p), 1, f);
+        std::fwrite(run.begin(), sizeof(double), p, f);
+        std::fwrite(&n, sizeof(n), 1, f);
+        for (size_t i = 0; i < n; ++i) {
+            double ti = r.time(i);
+            uint64_t bi = r.bits(i);
+            std::fwrite(&ti, sizeof(ti), 1, f);
+            std::fwrite(&bi, sizeof(bi), 1, f);
+        }
+        std::fflush(f);
+    }
+
+  private:
+    //! @brief Destructor, closing the file.
+    ~flight_writer() {
+        if (m_file != nullptr) std::fclose(m_file);
+    }
+
+    //! @brief The single writer.
+    static flight_writer& instance() {
+        static flight_writer w;
+        return w;
+    }
+
+    //! @brief The file, opened and truncated on first access.
+    std::FILE* file() {
+        if (m_file == nullptr and not m_failed) {
+            m_file = std::fopen(FCPP_FLIGHT_RECORDER_FILE, "wb");
+            m_failed = m_file == nullptr;
+            if (m_file != nullptr) std::fwrite("FCPPFLT2", 1, 8, m_file);
+        }
+        return m_file;
+    }
+
+    //! @brief Lock guarding the file.
+    std::mutex m_lock;
+    //! @brief The file.
+    std::FILE* m_file = nullptr;
+    //! @brief Whether the file could not be opened.
+    bool m_failed = false;
+};
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the node storage.
+namespace tags {
+    //! @brief Flight record of the propositions of the node.
+    struct flight_record {};
+}
+
+//! @brief The flight record type.
+using flight_record_t = flight_ring<FCPP_FLIGHT_RECORDER_SIZE>;
+
+//! @brief Stages the values of some propositions in the flight record of a node, starting from a given bit.
+template <typename node_t>
+void flight_stage(node_t& node, size_t first, std::initializer_list<bool> values) {
+    flight_record_t& r = node.storage(tags::flight_record{});
+    for (bool v : values) r.set(first++, v);
+}
+
+//! @brief Commits the staged propositions of the round, dumping the record (with the parameters of the run) when the monitors start failing.
+template <typename node_t>
+void flight_commit(node_t& node, bool ok, std::initializer_list<double> run) {
+    flight_record_t& r = node.storage(tags::flight_record{});
+    if (r.commit(node.current_time(), ok))
+        flight_writer::dump(node.uid, node.current_time(), run, r);
+}
+
+}
+
+}
+
+#endif // FCPP_RECORDER_H_
@@ -0,0 +1,144 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file registry.hpp
+ * @brief Implementation of objects shared by the devices of a network, living as long as its devices.
+ */
+
+#ifndef FCPP_REGISTRY_H_
+#define FCPP_REGISTRY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Reference to an object of type T shared by the devices of a network.
+ *
+ * Devices keep the reference in their storage: the object is created when the
+ * first device of a network accesses it, and destroyed with the last device
+ * holding it, so that a network later created at the same address starts anew.
+ * The object is held once per network, together with the number of references
+ * to it: a reference is a single pointer, which is looked up in the registry of
+ * networks only on its first access, and counted only when copied or destroyed.
+ */
+template <typename T>
+class network_ref {
+  public:
+    //! @brief Default constructor (referencing nothing).
+    network_ref() = default;
+
+    //! @brief Copy constructor (counting a further reference).
+    network_ref(network_ref const& r) : m_entry(r.m_entry) {
+        if (m_entry != nullptr) m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! @brief Copy assignment.
+    network_ref& operator=(network_ref r) {
+        std::swap(m_entry, r.m_entry);
+        return *this;
+    }
+
+    //! @brief Destructor, destroying the object with the last reference.
+    ~network_ref() {
+        if (m_entry == nullptr) return;
+        // references other than the last one are dropped without locking
+        for (size_t r = m_entry->refs.load(std::memory_order_relaxed); r > 1; )
+            if (m_entry->refs.compare_exchange_weak(r, r - 1, std::memory_order_acq_rel))
+                return;
+        // the last reference is dropped under the lock, so that no device references the object again meanwhile
+        std::lock_guard<std::mutex> l(lock());
+        if (m_entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        objects().erase(m_entry->net);
+        delete m_entry;
+    }
+
+    //! @brief The object of a network (default constructed if no device holds it).
+    static network_ref of(void const* net) {
+        return of(net, [](){
+            return new T();
+        });
+    }
+
+    //! @brief The object of a network (allocated by a given function if no device holds it).
+    template <typename F>
+    static network_ref of(void const* net, F&& make) {
+        std::lock_guard<std::mutex> l(lock());
+        entry*& e = objects()[net];
+        if (e == nullptr)
+            e = new entry(net, make());
+        else
+            e->refs.fetch_add(1, std::memory_order_relaxed);
+        network_ref r;
+        r.m_entry = e;
+        return r;
+    }
+
+    //! @brief Whether the reference is set.
+    explicit operator bool() const {
+        return m_entry != nullptr;
+    }
+
+    //! @brief Accesses the object referenced.
+    T& operator*() const {
+        return *m_entry->object;
+    }
+
+    //! @brief Accesses the object referenced.
+    T* operator->() const {
+        return m_entry->object;
+    }
+
+  private:
+    //! @brief The object of a network, with its number of references.
+    struct entry {
+        //! @brief Constructor given the network and the object (taking ownership).
+        entry(void const* n, T* o) : net(n), object(o) {}
+
+        //! @brief Destructor.
+        ~entry() {
+            delete object;
+        }
+
+        //! @brief The network.
+        void const* net;
+        //! @brief The object.
+        T* object;
+        //! @brief The number of references.
+        std::atomic<size_t> refs{1};
+    };
+
+    //! @brief Lock guarding the objects of every network.
+    static std::mutex& lock() {
+        static std::mutex m;
+        return m;
+    }
+
+    //! @brief The objects by network, while some device holds them.
+    static std::unordered_map<void const*, entry*>& objects() {
+        static std::unordered_map<void const*, entry*> m;
+        return m;
+    }
+
+    //! @brief The object referenced (with its number of references).
+    entry* m_entry = nullptr;
+};
+
+//! @brief Printing a reference to a shared object (in the user interface).
+template <typename T>
+std::ostream& operator<<(std::ostream& o, network_ref<T> const& r) {
+    return o << (r ? "shared" : "none");
+}
+
+}
+
+#endif // FCPP_REGISTRY_H_
@@ -11,6 +11,8 @@
 #include "lib/beautify.hpp"
 #include "lib/common/tagged_tuple.hpp"
 #include "lib/coordination/spreading.hpp"
+#include "lib/counting.hpp"
+#include "lib/profiler.hpp"
 
 #ifndef FCPP_DIAMETER
 #define FCPP_DIAMETER 20
@@ -31,62 +33,263 @@ namespace tags {
     struct diameter {};
 }
 
+//! @brief Namespace of implementation details.
+namespace details {
+    //! @brief Packs a sequence of up to 64 truth values into the bits of a word.
+    inline uint64_t pack(std::vector<bool> const& f) {
+        assert(f.size() <= 64);
+        uint64_t r = 0;
+        for (size_t i = 0; i < f.size(); ++i)
+            r |= uint64_t(f[i]) << i;
+        return r;
+    }
+
+    //! @brief Unpacks the lowest bits of a word into a sequence of truth values.
+    inline std::vector<bool> unpack(uint64_t x, size_t n) {
+        std::vector<bool> r(n);
+        for (size_t i = 0; i < n; ++i)
+            r[i] = (x >> i) & 1;
+        return r;
+    }
+
+    //! @brief Element-wise negation of a sequence of truth values.
+    inline std::vector<bool> negate(std::vector<bool> f) {
+        f.flip();
+        return f;
+    }
+}
+
+//! @brief Hop-count within a bounded horizon (up to 255), compactly exchanged.
+using horizon_t = uint8_t;
+
+//! @brief Hop-count distance from a source region up to a horizon, saturating to the horizon as unreachable marker.
+FUN horizon_t bounded_hops(ARGS, bool source, hops_t horizon) { CODE
+    PROFILE("bounded_hops");
+    assert(horizon <= std::numeric_limits<horizon_t>::max());
+    horizon_t h = horizon;
+    return nbr(CALL, h, [&](field<horizon_t> n) -> horizon_t {
+        horizon_t d = min_hood(CALL, n, h);
+        return source ? 0 : d < h ? d + 1 : h;
+    });
+}
+
+/**
+ * @brief Hop-count distances from many source regions at once up to a horizon, exchanged in a single export.
+ *
+ * The distance of every region propagates only through the devices where its
+ * mask is true (being the horizon elsewhere), as if computed by a scalar
+ * `bounded_hops` in a branch taken only by those devices.
+ */
+FUN std::vector<horizon_t> bounded_hops(ARGS, std::vector<bool> const& sources, std::vector<bool> const& within, hops_t horizon) { CODE
+    PROFILE("bounded_hops[]");
+    assert(horizon <= std::numeric_limits<horizon_t>::max());
+    std::vector<horizon_t> none(sources.size(), horizon);
+    return nbr(CALL, none, [&](field<std::vector<horizon_t>> const& n) {
+        // element-wise minimum of the distances of aligned neighbours (excluding self), in place
+        std::vector<horizon_t> d = none;
+        std::vector<device_t> const& ids = fcpp::details::get_ids(n);
+        auto const& vals = fcpp::details::get_vals(n);
+        for (size_t j = 0; j < ids.size(); ++j) {
+            if (ids[j] == node.uid) continue;
+            std::vector<horizon_t> const& y = vals[j+1];
+            for (size_t i = 0; i < y.size() and i < d.size(); ++i)
+                d[i] = min(d[i], y[i]);
+        }
+        for (size_t i = 0; i < d.size(); ++i)
+            d[i] = not within[i] ? horizon : sources[i] ? 0 : d[i] < horizon ? d[i] + 1 : horizon;
+        return d;
+    });
+}
+
+//! @brief Hop-count distances from many source regions at once up to a horizon, exchanged in a single export.
+FUN std::vector<horizon_t> bounded_hops(ARGS, std::vector<bool> const& sources, hops_t horizon) { CODE
+    return bounded_hops(CALL, sources, std::vector<bool>(sources.size(), true), horizon);
+}
+
+//! @brief Whether a source region is reachable within a number of hops (saturated to 255).
+FUN bool reachable(ARGS, bool source, hops_t horizon) { CODE
+    PROFILE("reachable");
+    horizon = min(horizon, hops_t(std::numeric_limits<horizon_t>::max()));
+    return bounded_hops(CALL, source, horizon) < horizon;
+}
+
+//! @brief Whether each of many source regions is reachable within a number of hops, through the devices in a mask (saturated to 255).
+FUN std::vector<bool> reachable(ARGS, std::vector<bool> const& sources, std::vector<bool> const& within, hops_t horizon) { CODE
+    PROFILE("reachable[]");
+    horizon = min(horizon, hops_t(std::numeric_limits<horizon_t>::max()));
+    std::vector<horizon_t> d = bounded_hops(CALL, sources, within, horizon);
+    std::vector<bool> r(d.size());
+    for (size_t i = 0; i < d.size(); ++i)
+        r[i] = d[i] < horizon;
+    return r;
+}
+
+//! @brief Whether each of many source regions is reachable within a number of hops (saturated to 255).
+FUN std::vector<bool> reachable(ARGS, std::vector<bool> const& sources, hops_t horizon) { CODE
+    return reachable(CALL, sources, std::vector<bool>(sources.size(), true), horizon);
+}
+
+//! @brief Estimates an upper bound to the diameter of a network, as twice the eccentricity of a source device.
+FUN hops_t diameter_estimate(ARGS, bool source) { CODE
+    PROFILE("diameter_estimate");
+    constexpr hops_t inf = std::numeric_limits<hops_t>::max();
+    hops_t d = abf_hops(CALL, source);
+    field<hops_t> nd = nbr(CALL, d);
+    // neighbours aligned with the gradient, with their distances from the source
+    std::vector<device_t> const& dom = fcpp::details::get_ids(nd);
+    auto const& dist = fcpp::details::get_vals(nd);
+    // maximum distance from the source, collected along the gradient (in a single scan)
+    hops_t ecc = nbr(CALL, d, [&](field<hops_t> const& e) {
+        details::field_cursor<hops_t> ce(e);
+        hops_t m = d;
+        for (size_t j = 0; j < dom.size(); ++j)
+            if (dist[j+1] > d) m = max(m, ce(dom[j]));
+        return m;
+    });
+    // eccentricity of the source, broadcasted along the gradient from the closest neighbour
+    hops_t r = nbr(CALL, ecc, [&](field<hops_t> const& b) {
+        if (source) return ecc;
+        details::field_cursor<hops_t> cb(b);
+        hops_t md = inf, mb = ecc;
+        for (size_t j = 0; j < dom.size(); ++j) {
+            if (dom[j] == node.uid) continue;
+            hops_t bj = cb(dom[j]);
+            if (dist[j+1] < md or (dist[j+1] == md and bj < mb)) {
+                md = dist[j+1];
+                mb = bj;
+            }
+        }
+        return mb;
+    });
+    return d == inf ? hops_t(FCPP_DIAMETER) : hops_t(2 * r + 1);
+}
+//! @brief Export types used by the diameter_estimate function.
+FUN_EXPORT diameter_estimate_t = export_list<abf_hops_t, hops_t>;
+
 //! @brief Exports for SLCS logic formulas.
-using slcs_t = export_list<bool, abf_hops_t>;
+using slcs_t = export_list<bool, horizon_t, uint64_t, std::vector<horizon_t>, diameter_estimate_t>;
 
 //! @brief Namespace containing logical operators and formulas.
 namespace logic {
 
 //! @brief Interior of a region.
 FUN bool I(ARGS, bool f) { CODE
-    return all_hood(CALL, nbr(CALL, true, f));
+    PROFILE("logic::I");
+    return all_true(CALL, nbr(CALL, true, f));
 }
 
 //! @brief Closure of a region.
 FUN bool C(ARGS, bool f) { CODE
-    return any_hood(CALL, nbr(CALL, false, f));
+    PROFILE("logic::C");
+    return any_true(CALL, nbr(CALL, false, f));
 }
 
 //! @brief Boundary of a region.
 FUN bool B(ARGS, bool f) { CODE
+    PROFILE("logic::B");
     return C(CALL, f) & !I(CALL, f);
 }
 
 //! @brief Interior boundary of a region.
 FUN bool IB(ARGS, bool f) { CODE
+    PROFILE("logic::IB");
     return f & !I(CALL, f);
 }
 
 //! @brief Closure boundary of a region.
 FUN bool CB(ARGS, bool f) { CODE
+    PROFILE("logic::CB");
     return C(CALL, f) & !f;
 }
 
-//! @brief Finally/somewhere operator.
+//! @brief Finally/somewhere operator (within the diameter).
 FUN bool F(ARGS, bool f) { CODE
-    return abf_hops(CALL, f) < common::get_or<tags::diameter>(node.storage_tuple(), FCPP_DIAMETER);
+    PROFILE("logic::F");
+    return reachable(CALL, f, common::get_or<tags::diameter>(node.storage_tuple(), FCPP_DIAMETER));
 }
 
 //! @brief Globally/everywhere operator.
 FUN bool G(ARGS, bool f) { CODE
+    PROFILE("logic::G");
     return !F(CALL, !f);
 }
 
 //! @brief Reaches operator.
 FUN bool R(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::R");
     return f1 ? F(CALL, f2) : false;
 }
 
 //! @brief Touches operator.
 FUN bool T(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::T");
     return R(CALL, f1, C(CALL, f2));
 }
 
 //! @brief Until/surrounding operator.
 FUN bool U(ARGS, bool f1, bool f2) { CODE
+    PROFILE("logic::U");
     return f1 & I(CALL, !R(CALL, !f2, !f1));
 }
 
+/**
+ * Operators on many regions at once, with a single export for every call.
+ * Formulas sharing the same operator can be batched together, so that all of
+ * their neighbourhood reductions and distance computations are performed once.
+ */
+
+//! @brief Interior of many regions.
+FUN std::vector<bool> I(ARGS, std::vector<bool> const& f) { CODE
+    PROFILE("logic::I[]");
+    uint64_t r = fold_hood(CALL, [](uint64_t x, uint64_t y) {
+        return x & y;
+    }, nbr(CALL, ~uint64_t(0), details::pack(f)));
+    return details::unpack(r, f.size());
+}
+
+//! @brief Closure of many regions.
+FUN std::vector<bool> C(ARGS, std::vector<bool> const& f) { CODE
+    PROFILE("logic::C[]");
+    uint64_t r = fold_hood(CALL, [](uint64_t x, uint64_t y) {
+        return x | y;
+    }, nbr(CALL, uint64_t(0), details::pack(f)));
+    return details::unpack(r, f.size());
+}
+
+//! @brief Finally/somewhere operator on many regions (within the diameter).
+FUN std::vector<bool> F(ARGS, std::vector<bool> const& f) { CODE
+    PROFILE("logic::F[]");
+    return reachable(CALL, f, common::get_or<tags::diameter>(node.storage_tuple(), FCPP_DIAMETER));
+}
+
+//! @brief Globally/everywhere operator on many regions.
+FUN std::vector<bool> G(ARGS, std::vector<bool> const& f) { CODE
+    PROFILE("logic::G[]");
+    return details::negate(F(CALL, details::negate(f)));
+}
+
+//! @brief Reaches operator on many pairs of regions.
+FUN std::vector<bool> R(ARGS, std::vector<bool> const& f1, std::vector<bool> const& f2) { CODE
+    PROFILE("logic::R[]");
+    // distances propagate only within f1, as in the scalar operator
+    return reachable(CALL, f2, f1, common::get_or<tags::diameter>(node.storage_tuple(), FCPP_DIAMETER));
+}
+
+//! @brief Touches operator on many pairs of regions.
+FUN std::vector<bool> T(ARGS, std::vector<bool> const& f1, std::vector<bool> const& f2) { CODE
+    PROFILE("logic::T[]");
+    return R(CALL, f1, C(CALL, f2));
+}
+
+//! @brief Until/surrounding operator on many pairs of regions.
+FUN std::vector<bool> U(ARGS, std::vector<bool> const& f1, std::vector<bool> const& f2) { CODE
+    PROFILE("logic::U[]");
+    std::vector<bool> r = I(CALL, details::negate(R(CALL, details::negate(f2), details::negate(f1))));
+    for (size_t i = 0; i < r.size(); ++i)
+        r[i] = f1[i] and r[i];
+    return r;
+}
+
 }
 
 }
@@ -0,0 +1,81 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file slots.hpp
+ * @brief Implementation of per-group slots, allocated in chunks when first used and safe to be concurrently accessed.
+ */
+
+#ifndef FCPP_SLOTS_H_
+#define FCPP_SLOTS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Slots of type T for every group, stored contiguously in chunks allocated when first used.
+ *
+ * Chunks are allocated concurrently without locking (the slower thread discarding
+ * its own), so that the slots of groups in use are reached in constant time by
+ * any thread. Slots must be default constructible, and safe to be concurrently
+ * accessed on their own.
+ */
+template <typename T>
+class group_slots {
+  public:
+    //! @brief Maximum number of groups.
+    static constexpr size_t max_groups = 1 << 16;
+
+    //! @brief Default constructor.
+    group_slots() = default;
+
+    //! @brief Copies are not allowed.
+    group_slots(group_slots const&) = delete;
+
+    //! @brief Destructor.
+    ~group_slots() {
+        for (auto& c : m_chunks)
+            delete [] c.load();
+    }
+
+    //! @brief Accesses the slot of a group, if allocated.
+    T const* find(size_t group) const {
+        if (group >= max_groups) return nullptr;
+        T const* p = m_chunks[group / chunk_size].load(std::memory_order_acquire);
+        return p == nullptr ? nullptr : p + group % chunk_size;
+    }
+
+    //! @brief Accesses the slot of a group, allocating its chunk if needed (throwing std::out_of_range beyond the maximum group).
+    T& get(size_t group) {
+        if (group >= max_groups)
+            throw std::out_of_range("group " + std::to_string(group) + " exceeds the maximum group identifier " + std::to_string(max_groups - 1));
+        std::atomic<T*>& c = m_chunks[group / chunk_size];
+        T* p = c.load(std::memory_order_acquire);
+        if (p == nullptr) {
+            T* q = new T[chunk_size];
+            if (c.compare_exchange_strong(p, q, std::memory_order_acq_rel))
+                p = q;
+            else
+                delete [] q;
+        }
+        return p[group % chunk_size];
+    }
+
+  private:
+    //! @brief Number of slots in a chunk.
+    static constexpr size_t chunk_size = 256;
+
+    //! @brief Chunks of slots.
+    std::atomic<T*> m_chunks[max_groups / chunk_size] = {};
+};
+
+}
+
+#endif // FCPP_SLOTS_H_
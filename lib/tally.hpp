@@ -0,0 +1,246 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file tally.hpp
+ * @brief Implementation of per-group counts of boolean values, maintained incrementally by devices.
+ */
+
+#ifndef FCPP_TALLY_H_
+#define FCPP_TALLY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <utility>
+
+#include "lib/beautify.hpp"
+#include "lib/coordination/utils.hpp"
+#include "lib/registry.hpp"
+#include "lib/slots.hpp"
+
+//! @brief Whether per-group counts of monitor values are maintained (and reported in the console and plots).
+#ifndef FCPP_TALLY
+#define FCPP_TALLY false
+#endif
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+/**
+ * @brief Counts of devices and of true values of a tag S in every group of a network.
+ *
+ * Devices only update the counts when their value or group changes, so that reading
+ * the counts costs as many groups as are in use, independently of the number of devices.
+ * Counts are stored in chunks of integers, allocated when first used (see lib/slots.hpp). The counts of
+ * a network are shared by its devices through their `tally_entry` (see below).
+ */
+template <typename S>
+class group_tally {
+    //! @brief Counts of a group (defined below).
+    struct count;
+
+  public:
+    //! @brief Maximum number of groups.
+    static constexpr size_t max_groups = group_slots<count>::max_groups;
+
+    //! @brief Adds (or removes, with a negative weight) a device with a value to a group.
+    void add(size_t group, bool value, int64_t weight) {
+        count& c = m_counts.get(group);
+        c.devices.fetch_add(weight, std::memory_order_relaxed);
+        if (value) c.values.fetch_add(weight, std::memory_order_relaxed);
+        size_t g = m_groups.load(std::memory_order_relaxed);
+        while (g <= group and not m_groups.compare_exchange_weak(g, group + 1, std::memory_order_relaxed));
+    }
+
+    //! @brief The number of devices in a group.
+    int64_t devices(size_t group) const {
+        count const* c = m_counts.find(group);
+        return c == nullptr ? 0 : c->devices.load(std::memory_order_relaxed);
+    }
+
+    //! @brief The number of true values in a group.
+    int64_t values(size_t group) const {
+        count const* c = m_counts.find(group);
+        return c == nullptr ? 0 : c->values.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Prints the fraction of true values in every group with devices.
+    void report(std::ostream& o) const {
+        std::ios_base::fmtflags flags = o.flags();
+        std::streamsize precision = o.precision();
+        o << std::left << std::setw(10) << "group" << std::right << std::setw(14) << "devices" << std::setw(14) << "true" << std::setw(14) << "fraction" << "\n";
+        int64_t d = 0, v = 0;
+        for (size_t g = 0; g < m_groups.load(std::memory_order_relaxed); ++g) {
+            int64_t dg = devices(g), vg = values(g);
+            if (dg == 0) continue;
+            o << std::left << std::setw(10) << g << std::right << std::setw(14) << dg << std::setw(14) << vg << std::setw(14) << std::fixed << std::setprecision(3) << double(vg) / dg << "\n";
+            d += dg;
+            v += vg;
+        }
+        o << std::left << std::setw(10) << "total" << std::right << std::setw(14) << d << std::setw(14) << v << std::setw(14) << std::fixed << std::setprecision(3) << (d ? double(v) / d : 0) << "\n";
+        o.flags(flags);
+        o.precision(precision);
+        o << std::flush;
+    }
+
+    //! @brief Prints the counts if some seconds have passed since the previous report.
+    void report_every(std::ostream& o, double seconds) {
+        int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t n = m_next.load(std::memory_order_relaxed);
+        if (now >= n and m_next.compare_exchange_strong(n, now + int64_t(seconds * 1000)))
+            report(o);
+    }
+
+  private:
+    //! @brief Counts of a group.
+    struct count {
+        //! @brief Number of devices.
+        std::atomic<int64_t> devices{0};
+        //! @brief Number of true values.
+        std::atomic<int64_t> values{0};
+    };
+
+    //! @brief Counts of every group.
+    group_slots<count> m_counts;
+    //! @brief One more than the highest group used.
+    std::atomic<size_t> m_groups{0};
+    //! @brief The time of the next report in milliseconds.
+    std::atomic<int64_t> m_next{0};
+};
+
+
+/**
+ * @brief The contribution of a device to the group tally of a tag S, kept in its storage.
+ *
+ * The contribution is removed when the device leaves the network (destroying its
+ * storage). Copies of an entry do not contribute to the counts.
+ */
+template <typename S>
+class tally_entry {
+  public:
+    //! @brief Default constructor (not contributing).
+    tally_entry() = default;
+
+    //! @brief Copy constructor (not contributing).
+    tally_entry(tally_entry const&) {}
+
+    //! @brief Copy assignment (leaving the contribution unchanged).
+    tally_entry& operator=(tally_entry const&) {
+        return *this;
+    }
+
+    //! @brief Destructor, removing the contribution.
+    ~tally_entry() {
+        if (m_counts and m_group != none)
+            m_counts->add(m_group, m_value, -1);
+    }
+
+    //! @brief Updates the contribution of the device to the counts of a network, only if it changed.
+    void update(void const* net, size_t group, bool value) {
+        if (not m_counts) m_counts = network_ref<group_tally<S>>::of(net);
+        if (group == m_group and value == m_value) return;
+        if (m_group != none) m_counts->add(m_group, m_value, -1);
+        m_counts->add(group, value, +1);
+        m_group = group;
+        m_value = value;
+    }
+
+    //! @brief The counts of the network (after the first update).
+    group_tally<S>& counts() const {
+        return *m_counts;
+    }
+
+    //! @brief Printing the contribution (in the user interface).
+    friend std::ostream& operator<<(std::ostream& o, tally_entry const& e) {
+        if (e.m_group == none) return o << "none";
+        return o << "group " << e.m_group << ": " << e.m_value;
+    }
+
+  private:
+    //! @brief Marker of no group.
+    static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+    //! @brief The counts of the network.
+    network_ref<group_tally<S>> m_counts;
+    //! @brief The group counted.
+    size_t m_group = none;
+    //! @brief The value counted.
+    bool m_value = false;
+};
+
+
+//! @brief Namespace of implementation details.
+namespace details {
+    //! @brief Appends the tags G<i>, ..., G<n-1> (each followed by V, unless void) to the arguments Ts of T.
+    template <template <typename...> class T, template <size_t> class G, typename V, size_t i, size_t n, typename... Ts>
+    struct group_list : group_list<T, G, V, i + 1, n, Ts..., G<i>, V> {};
+
+    //! @brief Appends the tags G<i>, ..., G<n-1> to the arguments Ts of T.
+    template <template <typename...> class T, template <size_t> class G, size_t i, size_t n, typename... Ts>
+    struct group_list<T, G, void, i, n, Ts...> : group_list<T, G, void, i + 1, n, Ts..., G<i>> {};
+
+    //! @brief The arguments Ts of T, once every tag is appended.
+    template <template <typename...> class T, template <size_t> class G, typename V, size_t n, typename... Ts>
+    struct group_list<T, G, V, n, n, Ts...> {
+        using type = T<Ts...>;
+    };
+
+    //! @brief The arguments Ts of T, once every tag is appended.
+    template <template <typename...> class T, template <size_t> class G, size_t n, typename... Ts>
+    struct group_list<T, G, void, n, n, Ts...> {
+        using type = T<Ts...>;
+    };
+}
+
+/**
+ * @brief The template T applied to arguments Ts followed by tags G<0>, V, ..., G<n-1>, V.
+ *
+ * Generates the tags and types (or aggregators) of `n` groups for options such as
+ * `tuple_store` or `aggregators`. With V equal to `void`, only the tags are listed.
+ */
+template <template <typename...> class T, template <size_t> class G, typename V, size_t n, typename... Ts>
+using group_list_t = typename details::group_list<T, G, V, 0, n, Ts...>::type;
+
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the node storage.
+namespace tags {
+    //! @brief The contribution of the node to the group tally of a tag S.
+    template <typename S>
+    struct tallied {};
+}
+
+//! @brief Counts the device and its value of a tag S in its group (through its tally entry in storage), updating the counts only on changes.
+GEN(S) void tally(ARGS, S, size_t group, bool value) { CODE
+    node.storage(tags::tallied<S>{}).update(&node.net, group, value);
+}
+//! @brief Export list for tally.
+FUN_EXPORT tally_t = export_list<>;
+
+/**
+ * @brief Stores under tags T<g> whether the device is in group g with a true value, for every g in a sequence 0, ..., n.
+ *
+ * The last tag T<n> collects every group from n on (as those read from files).
+ * Summing these tags through aggregators yields the count of true values in each
+ * group, in the plot pipeline (integers, pushed to aggregators only on changes).
+ */
+template <template <size_t> class T, size_t... gs, typename node_t>
+void tally_plot(node_t& node, size_t group, bool value, std::index_sequence<gs...>) {
+    constexpr size_t last = sizeof...(gs) - 1;
+    int dummy[] = {0, (node.storage(T<gs>{}) = value and (group == gs or (gs == last and group > last)), 0)...};
+    (void)dummy;
+}
+
+}
+
+}
+
+#endif // FCPP_TALLY_H_
@@ -0,0 +1,157 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file batch.cpp
+ * @brief Headless batch sweep of the aggregate computing monitoring exercises.
+ */
+
+//! @brief No graphical interface is used, so rendering and debug fields are dropped from the storage.
+#define FCPP_HEADLESS true
+//! @brief No flight records are kept, so that the storage of every node stays small in large sweeps.
+#define FCPP_FLIGHT_RECORDER_SIZE 0
+
+//! Importing the exercises (aggregate program and system setup).
+#include "exercises.hpp"
+//! Importing the columnar store of aggregated rows.
+#include "lib/columnar.hpp"
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief The final simulated time of every run.
+constexpr size_t end_time = 300;
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the network initialisation.
+namespace tags {
+    //! @brief Factor multiplying the speed of every group.
+    struct speed_scale {};
+    //! @brief Factor multiplying the radius of every group.
+    struct radius_scale {};
+}
+
+} // namespace coordination
+
+//! @brief Namespace for component options.
+namespace option {
+
+//! @brief Import tags to be used for component options.
+using namespace component::tags;
+//! @brief Import tags used by aggregate functions.
+using namespace coordination::tags;
+
+//! @brief Description of the round schedule (as in the exercises, ending at the final time).
+using batch_round_s = sequence::periodic<
+    distribution::interval_n<times_t, 0, 1>,     // uniform time in the [0,1] interval for start
+    distribution::weibull_n<times_t, 10, 1, 10>, // weibull-distributed time for interval (10/10=1 mean, 1/10=0.1 deviation)
+    distribution::constant_n<times_t, end_time>  // end of the rounds
+>;
+//! @brief The sequence of network snapshots (one every simulated second, until the final time).
+using batch_log_s = sequence::periodic_n<1, 0, 1, end_time>;
+
+//! @brief Option generating a group of nodes moving together, with parameters scaled by the network initialisation values.
+template <int group_id, int group_size, int group_radius, int group_speed = 0, int start_time = 0>
+using batch_group = scaled_group<
+    distribution::constant_i<double, speed_scale>,  // group speed scaled by the network initialisation value
+    distribution::constant_i<double, radius_scale>, // group radius scaled by the network initialisation value
+    group_id, group_size, group_radius, group_speed, start_time, -1, -1,
+    stream,   distribution::constant_i<uint64_t, seed>, // random streams keyed by the seed of the run (with FCPP_DETERMINISTIC)
+    diameter, distribution::constant_i<hops_t, diameter> // upper bound to the diameter used by SLCS operators
+>;
+
+#if FCPP_DIAMETER_ESTIMATE
+//! @brief No additional contents of the node storage (the diameter is already stored and estimated).
+using batch_store_t = tuple_store<>;
+#else
+//! @brief The diameter is also stored, to be swept across runs.
+using batch_store_t = tuple_store<diameter, hops_t>;
+#endif
+
+//! @brief The simulation options for headless runs (given the groups to be spawned).
+template <typename... Gs>
+DECLARE_OPTIONS(batch_list,
+    parallel<false>, // multithreading is used across runs instead of node rounds
+    round_schedule<batch_round_s>, // the sequence generator for round events on nodes
+    log_schedule<batch_log_s>,     // the sequence generator for log events on the network
+    batch_store_t,                 // the additional contents of the node storage
+    plot_type<columnar_plotter<plotter_t>>, // rows are streamed to a columnar file, plotted at the end
+    setup,                         // the options shared by every execution mode
+    Gs...
+);
+
+//! @brief The groups of the exercises scenario.
+using default_list = batch_list<
+    batch_group<0, 1,  0,   20>,
+    batch_group<1, 20, 50,  3>,
+    batch_group<2, 10, 20,  5>,
+    batch_group<3, 10, 80,  5>,
+    batch_group<4, 40, 200, 10>
+>;
+
+//! @brief A crowded variant of the scenario, with larger groups.
+using crowded_list = batch_list<
+    batch_group<0, 1,  0,   20>,
+    batch_group<1, 60, 50,  3>,
+    batch_group<2, 40, 20,  5>,
+    batch_group<3, 40, 80,  5>,
+    batch_group<4, 90, 200, 10>
+>;
+
+} // namespace option
+
+//! @brief The columnar file of the aggregated rows of a scenario.
+std::string columnar_file(std::string const& name) {
+    return "output/" + name + ".col";
+}
+
+//! @brief Runs every combination of parameters for a scenario in parallel, writing one output file per run.
+template <typename O>
+void sweep(std::string const& name, map_navigator const& obj) {
+    //! @brief The component type (batch simulator with given options).
+    using comp_t = component::batch_simulator<O>;
+    //! @brief Create the plotter object, streaming to a columnar file.
+    columnar_plotter<option::plotter_t> p(columnar_file(name));
+    //! @brief The list of initialisation values to be used for simulations.
+    auto init_list = batch::make_tagged_tuple_list<option::seed, option::diameter, option::speed_scale, option::radius_scale, option::output, option::map_navigator_obj, option::plotter>(
+        batch::arithmetic<option::seed>(0, 9, 1),             // 10 different random seeds
+        batch::list<option::diameter>(10, 20, 40),            // 3 different diameter bounds
+        batch::list<option::speed_scale>(0.5, 1.0, 2.0),      // 3 different group speeds
+        batch::list<option::radius_scale>(0.5, 1.0, 2.0),     // 3 different group radii
+        batch::stringify<option::output>("output/raw/" + name, "txt"), // generate output file name for the run
+        batch::constant<option::map_navigator_obj>(obj),      // the navigator from the obstacles map
+        batch::constant<option::plotter>(&p)                  // reference to the plotter object
+    );
+    //! @brief Runs the given simulations, as many at once as there are cores.
+    batch::run(comp_t{}, common::tags::dynamic_execution{}, init_list);
+}
+
+//! @brief Writes the plots of a scenario from its columnar file.
+void plot_sweep(std::string const& name) {
+    option::plotter_t p;
+    if (columnar_plotter<option::plotter_t>::replay(columnar_file(name), p))
+        std::ofstream("output/" + name + ".asy") << plot::file(name, p.build());
+    else
+        std::cerr << "cannot read " << columnar_file(name) << std::endl;
+}
+
+} // namespace fcpp
+
+
+//! @brief The main function (with `--replay`, only plots the results of a previous run).
+int main(int argc, char** argv) {
+    using namespace fcpp;
+
+    if (argc < 2 or std::string(argv[1]) != "--replay") {
+        //! @brief Create the navigator from the obstacles map (shared by every run).
+        map_navigator obj = map_navigator("obstacles.png");
+        sweep<option::default_list>("batch_default", obj);
+        sweep<option::crowded_list>("batch_crowded", obj);
+    }
+    plot_sweep("batch_default");
+    plot_sweep("batch_crowded");
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file connector_bench.cpp
+ * @brief Benchmark of neighbour discovery for growing densities of devices, static or moving in groups.
+ *
+ * Only the `connect::fixed` connector of FCPP is measured: a grid connector with
+ * cell migration is not provided, since connectors are components of FCPP (not of
+ * this repository), so that an alternative connector belongs to FCPP itself. New
+ * connectors can be compared here by adding their sweeps in the main function.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+//! Importing the exercises (for the communication range and libraries in use).
+#include "exercises.hpp"
+//! Importing the spawning of groups at runtime.
+#include "lib/groups.hpp"
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief The simulated duration of every benchmark run.
+constexpr size_t connector_bench_time = 10;
+
+//! @brief Counters accumulated across the rounds of a benchmark run.
+struct connector_counters {
+    //! @brief Number of rounds executed.
+    static std::atomic<size_t> rounds;
+    //! @brief Total number of neighbours found.
+    static std::atomic<size_t> neighbours;
+};
+std::atomic<size_t> connector_counters::rounds{0};
+std::atomic<size_t> connector_counters::neighbours{0};
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the network initialisation.
+namespace tags {
+    //! @brief Number of nodes in the network.
+    struct node_count {};
+    //! @brief Side of the square area containing the network.
+    struct side {};
+}
+
+//! @brief Counts the neighbours found in the round (the only aggregate work done).
+FUN void connector_program(ARGS) { CODE
+    ++connector_counters::rounds;
+    connector_counters::neighbours += count_where(CALL, nbr(CALL, true));
+}
+//! @brief Export types used by the connector_program function.
+FUN_EXPORT connector_program_t = export_list<bool>;
+
+//! @brief Main struct calling the benchmark program.
+struct connector_main {
+    //! @brief The main function.
+    template <typename node_t>
+    void operator()(node_t& node, times_t) {
+        connector_program(CALL);
+    }
+};
+
+//! @brief Main struct moving devices in groups before calling the benchmark program.
+struct connector_walk_main {
+    //! @brief The main function.
+    template <typename node_t>
+    void operator()(node_t& node, times_t) {
+        group_walk(CALL);
+        connector_program(CALL);
+    }
+};
+//! @brief Export types used by the connector_walk_main function.
+FUN_EXPORT connector_walk_main_t = export_list<group_walk_t, connector_program_t>;
+
+} // namespace coordination
+
+//! @brief Namespace for component options.
+namespace option {
+
+//! @brief Import tags to be used for component options.
+using namespace component::tags;
+//! @brief Import tags used by aggregate functions.
+using namespace coordination::tags;
+
+//! @brief Description of the round schedule (one round every second, with random start).
+using connector_round_s = sequence::periodic<
+    distribution::interval_n<times_t, 0, 1>,
+    distribution::constant_n<times_t, 1>,
+    distribution::constant_n<times_t, connector_bench_time>
+>;
+//! @brief All nodes are spawned at the start.
+using connector_spawn_s = sequence::multiple<distribution::constant_i<size_t, node_count>, distribution::constant_n<times_t, 0>>;
+//! @brief Nodes are randomly displaced in a square area.
+using connector_rectangle_d = distribution::rect<
+    distribution::constant_n<real_t, 0>, distribution::constant_n<real_t, 0>,
+    distribution::constant_i<real_t, side>, distribution::constant_i<real_t, side>
+>;
+
+//! @brief The benchmark options, given the connector to be measured.
+template <typename C>
+DECLARE_OPTIONS(connector_list,
+    parallel<false>,     // rounds are measured in a single thread
+    synchronised<false>, // optimise for asynchronous networks
+    program<coordination::connector_main>, // program to be run
+    exports<coordination::connector_program_t>, // export type list (types used in messages)
+    retain<metric::retain<3,1>>,           // messages are kept for 3 seconds before expiring
+    round_schedule<connector_round_s>,     // the sequence generator for round events on nodes
+    spawn_schedule<connector_spawn_s>,     // the sequence generator of node creation events
+    init<x, connector_rectangle_d>,
+    connector<C> // the connector measured
+);
+
+//! @brief The storage needed for moving in groups.
+using connector_walk_store_t = tuple_store<
+    speed,                      double,
+    offset,                     double,
+    group,                      group_t,
+    leader,                     device_t,
+    stream,                     uint64_t,
+#if FCPP_DETERMINISTIC
+    target_round,               uint64_t,
+#endif
+    shared_walk,                network_ref<walk_state>
+>;
+
+//! @brief The benchmark options with devices moving in groups, given the connector to be measured.
+template <typename C>
+DECLARE_OPTIONS(connector_walk_list,
+    parallel<false>,     // rounds are measured in a single thread
+    synchronised<false>, // optimise for asynchronous networks
+    program<coordination::connector_walk_main>, // program to be run
+    exports<coordination::connector_walk_main_t>, // export type list (types used in messages)
+    retain<metric::retain<3,1>>,           // messages are kept for 3 seconds before expiring
+    round_schedule<connector_round_s>,     // the sequence generator for round events on nodes
+    connector_walk_store_t,  // the contents of the node storage
+    area<0, 0, hi_x, hi_y>,  // bounding coordinates of the simulated space
+    connector<C> // the connector measured
+);
+
+} // namespace option
+
+//! @brief The size of the moving groups (packed within a radius of 20, as in the densest static layout).
+constexpr size_t connector_group_size = 40;
+
+//! @brief Runs the benchmark of a connector, for growing numbers of nodes and densities.
+template <typename C>
+void connector_sweep(char const* name) {
+    //! @brief Stream discarding the simulation output.
+    std::ofstream discard;
+    //! @brief The network object type (batch simulator with benchmark options).
+    using net_t = typename component::batch_simulator<option::connector_list<C>>::net;
+    for (size_t n : {1000, 10000, 50000})
+        for (double degree : {10.0, 40.0, 160.0, 640.0}) {
+            // side of the area yielding the given average number of neighbours
+            // (a degree of 40 is reached by groups of 40 packed within a radius of 20)
+            double side = std::sqrt(n * std::acos(-1) * communication_range * communication_range / degree);
+            connector_counters::rounds = 0;
+            connector_counters::neighbours = 0;
+            auto init_v = common::make_tagged_tuple<option::node_count, option::side, option::output>(n, side, &discard);
+            auto start = std::chrono::steady_clock::now();
+            {
+                net_t network{init_v};
+                network.run();
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            size_t rounds = connector_counters::rounds;
+            std::printf("%-16s %8zu %8.0f %10.1f %14.0f %14.0f\n", name, n, degree, connector_counters::neighbours / double(rounds), rounds / elapsed, connector_counters::neighbours / elapsed);
+            std::fflush(stdout);
+        }
+}
+
+//! @brief Runs the benchmark of a connector, for growing numbers of nodes moving in groups across the map.
+template <typename C>
+void connector_walk_sweep(char const* name, map_navigator const& obj) {
+    //! @brief Stream discarding the simulation output.
+    std::ofstream discard;
+    //! @brief The network object type (batch simulator with benchmark options for moving devices).
+    using net_t = typename component::batch_simulator<option::connector_walk_list<C>>::net;
+    for (size_t n : {1000, 10000, 50000}) {
+        // groups of 40 within a radius of 20 running at 10 km/h, so that neighbours change as groups meet
+        std::vector<group_spec> groups(n / connector_group_size, group_spec{connector_group_size, 20, 10, 0, make_vec(-1, -1)});
+        connector_counters::rounds = 0;
+        connector_counters::neighbours = 0;
+        auto init_v = common::make_tagged_tuple<option::output, option::map_navigator_obj>(&discard, obj);
+        auto start = std::chrono::steady_clock::now();
+        {
+            net_t network{init_v};
+            spawn_groups(network, groups, 0, 0);
+            network.run();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t rounds = connector_counters::rounds;
+        std::printf("%-16s %8zu %8s %10.1f %14.0f %14.0f\n", name, n, "walk", connector_counters::neighbours / double(rounds), rounds / elapsed, connector_counters::neighbours / elapsed);
+        std::fflush(stdout);
+    }
+}
+
+} // namespace fcpp
+
+
+//! @brief The main function.
+int main() {
+    using namespace fcpp;
+
+    std::printf("%-16s %8s %8s %10s %14s %14s\n", "connector", "nodes", "degree", "found", "rounds/s", "neighbours/s");
+    connector_sweep<connect::fixed<communication_range>>("fixed");
+    //! @brief Create the navigator from the obstacles map (for moving devices).
+    map_navigator obj = map_navigator("obstacles.png");
+    connector_walk_sweep<connect::fixed<communication_range>>("fixed", obj);
+    // ... add alternative connectors here (as FCPP components), to pick the fastest one per density
+    return 0;
+}
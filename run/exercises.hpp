@@ -0,0 +1,423 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file exercises.hpp
+ * @brief Aggregate computing monitoring exercises.
+ */
+
+#ifndef FCPP_EXERCISES_H_
+#define FCPP_EXERCISES_H_
+
+// [INTRODUCTION]
+
+#define FCPP_WARNING_TRACE false
+
+//! @brief Whether time spent in aggregate functions is profiled (in the console and plots).
+#ifndef FCPP_PROFILE
+#define FCPP_PROFILE false
+#endif
+
+//! @brief Whether the diameter of every group is estimated at runtime (instead of using FCPP_DIAMETER).
+#ifndef FCPP_DIAMETER_ESTIMATE
+#define FCPP_DIAMETER_ESTIMATE false
+#endif
+
+//! @brief Whether the simulation runs without graphical interface (dropping rendering and debug fields from the storage).
+#ifndef FCPP_HEADLESS
+#define FCPP_HEADLESS false
+#endif
+
+//! @brief Whether per-group counts of consistent devices are maintained incrementally (printed in the console and plotted).
+#ifndef FCPP_TALLY
+#define FCPP_TALLY false
+#endif
+
+//! @brief Whether the rounds of devices standing still in an unchanging neighbourhood are stretched.
+#ifndef FCPP_QUIESCENCE
+#define FCPP_QUIESCENCE false
+#endif
+
+//! @brief Whether MAIN evaluates the hand-written consistency monitor (to be edited in the exercises) instead of its formula.
+#ifndef FCPP_HANDWRITTEN_MONITOR
+#define FCPP_HANDWRITTEN_MONITOR false
+#endif
+
+//! Importing the FCPP library.
+#include "lib/fcpp.hpp"
+#include "lib/counting.hpp"
+#include "lib/formula.hpp"
+#include "lib/past_ctl.hpp"
+#include "lib/slcs.hpp"
+#include "lib/mobility.hpp"
+#include "lib/movement.hpp"
+#include "lib/quiescence.hpp"
+#include "lib/recorder.hpp"
+#include "lib/tally.hpp"
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief The maximum communication range between nodes.
+constexpr size_t communication_range = 100;
+
+//! @brief The number of groups whose consistent devices are plotted on their own (those spawned through options, with FCPP_TALLY).
+constexpr size_t plotted_groups = 5;
+
+//! @brief The number of tags counting consistent devices per group (a further one collecting the groups not plotted on their own).
+constexpr size_t tallied_groups = FCPP_TALLY ? plotted_groups + 1 : 0;
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the node storage.
+namespace tags {
+    //! @brief Color of the current node.
+    struct node_color {};
+    //! @brief Size of the current node.
+    struct node_size {};
+    //! @brief Shape of the current node.
+    struct node_shape {};
+    //! @brief Value of the consistency monitor.
+    struct consistency {};
+    //! @brief Whether the current node is consistent and in group g (or after g, for g equal to plotted_groups), summed per group in plots (with FCPP_TALLY).
+    template <size_t g>
+    struct group_consistency {};
+    //! @brief Microseconds spent in the last round for movement (with FCPP_PROFILE).
+    struct movement_time {};
+    //! @brief Microseconds spent in the last round for basic propositions (with FCPP_PROFILE).
+    struct proposition_time {};
+    //! @brief Microseconds spent in the last round for monitors (with FCPP_PROFILE).
+    struct monitor_time {};
+    // ... add more as needed, here and in the tuple_store<...> option below
+}
+
+// [AGGREGATE PROGRAM]
+
+/**
+ * EXERCISES
+ *
+ * Monitor the following additional properties:
+ *
+ * 1)    You do not enter a cluster without a previous warning.
+ *
+ * 2)    You do not enter a cluster without some member of your group having a warning.
+ *
+ * 3)    You can always reach a node that is not in a cluster.
+ *
+ * 4)    You can always reach a node that has never been in a cluster.
+ *
+ * Every exercise above is designed to help solving the following one.
+ *
+ * Solutions can be written by hand, as in `consistency_monitor` below (building
+ * with FCPP_HANDWRITTEN_MONITOR defined as true to see its value in the user
+ * interface), or as formulas, added to the `monitors` evaluated by MAIN.
+ */
+
+/**
+ * @brief If some node is in cluster alert, it stays alerted until everyone in its group becomes in cluster alert.
+ *
+ * MAIN evaluates this monitor as the `consistency_formula` below, together with
+ * the other monitors. Building with FCPP_HANDWRITTEN_MONITOR defined as true, MAIN
+ * stores the value of this hand-written version instead, so that edits to it are
+ * shown in the user interface.
+ */
+FUN bool consistency_monitor(ARGS, bool cluster) { CODE
+    PROFILE("consistency_monitor");
+    using namespace logic;
+    // execute independently in different groups
+    return split(CALL, node.storage(tags::group{}), [&](){
+#if FCPP_DIAMETER_ESTIMATE
+        // bound the SLCS operators to the diameter of the group, estimated from its leader
+        node.storage(tags::diameter{}) = diameter_estimate(CALL, node.uid == node.storage(tags::leader{}));
+#endif
+        bool alert_start = Y(CALL, !cluster) & cluster;
+        bool alert_end = Y(CALL, cluster) & (!cluster);
+        bool all_alerted = G(CALL, cluster);
+        bool no_new_alarms_after_all_alerted = AS(CALL, !alert_start, all_alerted);
+        // keep the sub-formulas in the flight record of the node (see MAIN)
+        flight_stage(node, 2, {alert_start, alert_end, all_alerted, no_new_alarms_after_all_alerted});
+        // if the alert is ending, there must have been no new alarms after a moment when everyone was alerted
+        return alert_end <= no_new_alarms_after_all_alerted;
+        // notice that boolean operators to be used are &, |, !, <=
+        // in particular A <= B is used for "A implies B", which feels reversed
+        // (the reason being that <= is also less-than-or-equal on booleans)
+    });
+}
+FUN_EXPORT monitor_t = export_list<past_ctl_t, slcs_t>;
+
+//! @brief The warning proposition, in the formulas below.
+constexpr formula::prop<0> warning_prop{};
+//! @brief The cluster proposition, in the formulas below.
+constexpr formula::prop<1> cluster_prop{};
+
+//! @brief A node enters cluster alert (sub-formula of the consistency monitor).
+constexpr auto alert_start_formula = formula::Y(!cluster_prop) & cluster_prop;
+//! @brief A node leaves cluster alert (sub-formula of the consistency monitor).
+constexpr auto alert_end_formula = formula::Y(cluster_prop) & !cluster_prop;
+//! @brief Everyone is in cluster alert (sub-formula of the consistency monitor).
+constexpr auto all_alerted_formula = formula::G(cluster_prop);
+//! @brief No new alarms since everyone was in cluster alert (sub-formula of the consistency monitor).
+constexpr auto no_new_alarms_formula = formula::AS(!alert_start_formula, all_alerted_formula);
+
+//! @brief The consistency monitor above, as a formula.
+constexpr auto consistency_formula = alert_end_formula <= no_new_alarms_formula;
+
+/**
+ * @brief Monitors evaluated together in every group (see MAIN).
+ *
+ * Named monitors store their value under their own tag, which should also be
+ * added to the tuple_store and aggregators options below; the values of the
+ * other formulas are only kept in the flight record. Subformulas shared between
+ * monitors (such as `Y(cluster_prop)` or `G(cluster_prop)`) are computed once.
+ */
+constexpr auto monitors = std::make_tuple(
+    formula::monitor<tags::consistency>(consistency_formula),
+    alert_start_formula, alert_end_formula, all_alerted_formula, no_new_alarms_formula
+    // ... add the exercises as named monitors, here and in the options below
+);
+//! @brief Export types used by the monitors.
+FUN_EXPORT monitors_t = formula::exports<decltype(monitors)>;
+
+//! @brief Main function.
+MAIN() {
+    using namespace tags;
+    // opt-in profiling of the round (see lib/profiler.hpp)
+    PROFILE("main");
+
+    // call to the library function handling group-based movement (or replay it from a trace)
+#if FCPP_MOBILITY_REPLAY
+    if (not mobility_replay(node))
+#endif
+    group_walk(CALL);
+#if FCPP_CHECKPOINT_RESTORE
+    // start from the positions (and time) reached at the end of a warm-up run
+    node.storage(warmup{}) = checkpoint_restore(CALL);
+#endif
+#if FCPP_MOBILITY_RECORD
+    mobility_record(node);
+#endif
+#if FCPP_CHECKPOINT_TIME >= 0
+    checkpoint_save(CALL, FCPP_CHECKPOINT_TIME);
+#endif
+    PROFILE_LAP(movement_time);
+
+    // compute basic propositions
+    bool warning = count_within(CALL, 0.25*communication_range) > 5; // more than 5 neighbours within 25m?
+    bool cluster = count_where(CALL, nbr(CALL, warning)) >= 3; // at least 3 neighbours also on "warning"?
+    PROFILE_LAP(proposition_time);
+
+    // sample logic formula, recording the propositions of the last rounds in case it fails
+    // (bits: warning, cluster, alert_start, alert_end, all_alerted, no_new_alarms_after_all_alerted)
+    flight_stage(node, 0, {warning, cluster});
+#if FCPP_QUIESCENCE
+    // values of the monitors (one per bit), digesting their state for quiescence
+    uint64_t monitor_bits = 0;
+#endif
+    // execute independently in different groups
+    split(CALL, node.storage(group{}), [&](){
+        PROFILE("monitors");
+#if FCPP_DIAMETER_ESTIMATE
+        // bound the SLCS operators to the diameter of the group, estimated from its leader
+        node.storage(diameter{}) = diameter_estimate(CALL, node.uid == node.storage(leader{}));
+#endif
+        std::array<bool, 5> r = formula::evaluate(CALL, monitors, warning, cluster);
+        flight_stage(node, 2, {r[1], r[2], r[3], r[4]});
+#if FCPP_QUIESCENCE
+        for (size_t i = 0; i < r.size(); ++i)
+            monitor_bits |= uint64_t(r[i]) << i;
+#endif
+    });
+#if FCPP_HANDWRITTEN_MONITOR
+    // the hand-written monitor replaces the value of its formula
+    node.storage(consistency{}) = consistency_monitor(CALL, cluster);
+#if FCPP_QUIESCENCE
+    monitor_bits |= uint64_t(node.storage(consistency{})) << 5;
+#endif
+#endif
+    bool monitor_result = node.storage(consistency{});
+    // dump the flight record on failures, keyed by the parameters of the run (seed, diameter bound, group speed and radius)
+    flight_commit(node, monitor_result, {
+        double(node.storage(stream{})), double(common::get_or<diameter>(node.storage_tuple(), FCPP_DIAMETER)),
+        double(node.storage(speed{})), double(node.storage(offset{}))
+    });
+    PROFILE_LAP(monitor_time);
+
+#if FCPP_TALLY
+    // per-group counts of consistent devices, printed every 10 seconds and plotted
+    tally(CALL, consistency{}, node.storage(group{}), monitor_result);
+    node.storage(tallied<consistency>{}).counts().report_every(std::cout, 10);
+    tally_plot<group_consistency>(node, node.storage(group{}), monitor_result, std::make_index_sequence<tallied_groups>{});
+#endif
+
+#if not FCPP_HEADLESS
+    // display formula values in the user interface
+    node.storage(node_size{}) = cluster ? 20 : 10;
+    node.storage(node_color{}) = color(monitor_result ? GREEN : RED);
+    node.storage(node_shape{}) = warning ? shape::star : shape::sphere;
+#endif
+
+#if FCPP_QUIESCENCE
+    // stretch the rounds of devices standing still, with nothing changing around them (including monitors)
+    uint64_t moving = norm(node.velocity()) > 0 ? uint64_t(node.current_time() * 1000) + 1 : 0;
+    stretch_rounds(CALL, quiescent_rounds(CALL, details::mix(details::mix(moving, warning + 2 * cluster), monitor_bits)));
+#endif
+
+#if FCPP_PROFILE
+    // print profiling statistics every 10 seconds
+    profiler::report_every(std::cout, 10);
+#endif
+}
+//! @brief Export types used by the main function (update it when expanding the program).
+FUN_EXPORT main_t = export_list<group_walk_t, diameter_estimate_t, monitor_t, monitors_t, tally_t, quiescent_rounds_t, checkpoint_save_t, checkpoint_restore_t>;
+
+} // namespace coordination
+
+// [SYSTEM SETUP]
+
+//! @brief Namespace for component options.
+namespace option {
+
+//! @brief Import tags to be used for component options.
+using namespace component::tags;
+//! @brief Import tags used by aggregate functions.
+using namespace coordination::tags;
+
+//! @brief Description of the round schedule.
+using round_s = sequence::periodic<
+    distribution::interval_n<times_t, 0, 1>,    // uniform time in the [0,1] interval for start
+    distribution::weibull_n<times_t, 10, 1, 10> // weibull-distributed time for interval (10/10=1 mean, 1/10=0.1 deviation)
+>;
+//! @brief The sequence of network snapshots (one every simulated second).
+using log_s = sequence::periodic_n<1, 0, 1>;
+//! @brief The contents of the node storage as tags and associated types, given the template holding them (ending with the per-group tags).
+template <template <typename...> class T>
+using store_of = group_list_t<T, group_consistency, bool, tallied_groups,
+#if not FCPP_HEADLESS
+    node_color,                 color,
+    node_size,                  double,
+    node_shape,                 shape,
+    debug,                      std::string,
+#endif
+#if FCPP_DIAMETER_ESTIMATE
+    diameter,                   hops_t,
+#endif
+#if FCPP_CHECKPOINT_RESTORE
+    warmup,                     times_t,
+#endif
+#if FCPP_PROFILE
+    movement_time,              double,
+    proposition_time,           double,
+    monitor_time,               double,
+#endif
+    speed,                      double,
+    offset,                     double,
+    group,                      group_t,
+    leader,                     device_t,
+    stream,                     uint64_t,
+#if FCPP_DETERMINISTIC
+    target_round,               uint64_t,
+#endif
+    shared_walk,                network_ref<walk_state>,
+#if FCPP_TALLY
+    tallied<consistency>,       tally_entry<consistency>,
+#endif
+    consistency,                bool, // a bool per monitor, as aggregators read a single value per tag
+    flight_record,              flight_record_t
+>;
+//! @brief The contents of the node storage as tags and associated types.
+using store_t = store_of<tuple_store>;
+#if FCPP_HEADLESS and FCPP_FLIGHT_RECORDER_SIZE == 0 and not (FCPP_DIAMETER_ESTIMATE or FCPP_CHECKPOINT_RESTORE or FCPP_PROFILE or FCPP_DETERMINISTIC or FCPP_TALLY)
+static_assert(sizeof(store_of<common::tagged_tuple_t>) <= 64, "the headless storage should fit in 64 bytes per node");
+#endif
+//! @brief The tags and corresponding aggregators to be logged (change as needed, ending with the per-group tags).
+using aggregator_t = group_list_t<aggregators, group_consistency, aggregator::sum<int>, tallied_groups,
+#if FCPP_PROFILE
+    movement_time,              aggregator::mean<double>,
+    proposition_time,           aggregator::mean<double>,
+    monitor_time,               aggregator::mean<double>,
+#endif
+    consistency,                aggregator::mean<double>
+>;
+
+//! @brief Plot of the monitors.
+using monitor_plot_t = plot::split<plot::time, plot::values<aggregator_t, common::type_sequence<>, consistency>>;
+#if FCPP_PROFILE
+//! @brief Plot of the time spent per round.
+using profile_plot_t = plot::split<plot::time, plot::values<aggregator_t, common::type_sequence<>, movement_time, proposition_time, monitor_time>>;
+#endif
+#if FCPP_TALLY
+//! @brief Plot of the consistent devices per group.
+using tally_plot_t = plot::split<plot::time, group_list_t<plot::values, group_consistency, void, tallied_groups, aggregator_t, common::type_sequence<>>>;
+#endif
+
+#if FCPP_PROFILE or FCPP_TALLY
+//! @brief Plot description (with time spent per round or consistent devices per group).
+using plotter_t = plot::join<
+    monitor_plot_t
+#if FCPP_PROFILE
+    , profile_plot_t
+#endif
+#if FCPP_TALLY
+    , tally_plot_t
+#endif
+>;
+#else
+//! @brief Plot description.
+using plotter_t = monitor_plot_t;
+#endif
+
+//! @brief The simulation options shared by every execution mode (except node spawning).
+DECLARE_OPTIONS(setup,
+    synchronised<false>, // optimise for asynchronous networks
+    program<coordination::main>,   // program to be run (refers to MAIN above)
+    exports<coordination::main_t>, // export type list (types used in messages)
+    retain<metric::retain<3,1>>,   // messages are kept for 3 seconds before expiring
+    round_schedule<round_s>, // the sequence generator for round events on nodes
+    log_schedule<log_s>,     // the sequence generator for log events on the network
+    store_t,       // the contents of the node storage
+    aggregator_t,  // the tags and corresponding aggregators to be logged
+    value_push<true>, // aggregators are updated as node storages change, instead of scanning every node at log time
+    plot_type<plotter_t>, // the plot description
+    area<0, 0, hi_x, hi_y>, // bounding coordinates of the simulated space
+    connector<connect::fixed<communication_range>>, // connection allowed within a fixed comm range
+    shape_tag<node_shape>, // the shape of a node is read from this tag in the store
+    size_tag<node_size>,   // the size  of a node is read from this tag in the store
+    color_tag<node_color>  // the color of a node is read from this tag in the store
+);
+
+//! @brief The general simulation options.
+DECLARE_OPTIONS(list,
+    parallel<true>, // multithreading enabled on node rounds
+    setup,          // the options shared by every execution mode
+    // group-id, number of nodes in group, radius, speed:
+    spawn_group<0, 1,  0,   20>, // group 0: a single node biking
+    spawn_group<1, 20, 50,  3>,  // group 1: a large group strolling
+    spawn_group<2, 10, 20,  5>,  // group 2: a medium sized, tightly packed group walking
+    spawn_group<3, 10, 80,  5>,  // group 3: a medium sized, loosely packed group walking
+    spawn_group<4, 40, 200, 10>
+    // add groups as you wish
+    /**
+     * realistic urban speeds:
+     * - standing:  0 km/h
+     * - strolling: 3 km/h
+     * - walking:   5 km/h
+     * - running:  10 km/h
+     * - biking:   20 km/h
+     * - slow car: 30 km/h
+     * - fast car: 50 km/h
+     * - drone:    80 km/h
+     */
+);
+
+} // namespace option
+
+inline std::ostream& operator<<(std::ostream& o, map_navigator const&) {
+    return o;
+}
+
+} // namespace fcpp
+
+
+#endif // FCPP_EXERCISES_H_
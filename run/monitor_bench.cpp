@@ -0,0 +1,285 @@
+// Copyright © 2022 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file monitor_bench.cpp
+ * @brief Microbenchmark of the logic operators and monitors on synthetic networks.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+//! Importing the exercises (for the monitors and libraries in use).
+#include "exercises.hpp"
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief The simulated duration of every benchmark run.
+constexpr size_t bench_time = 20;
+
+//! @brief The time bound of the time-bounded operators (in simulated seconds).
+constexpr times_t bench_within = 5;
+
+//! @brief The number of devices with consecutive identifiers in a group.
+constexpr device_t bench_group_size = 100;
+
+//! @brief Operators measured by the benchmark.
+enum class bench_op { none, Y, AY, EY, S, AS, ES, P, AP, EP, H, AH, EH, S_within, AS_within, ES_within, P_within, AP_within, EP_within, H_within, AH_within, EH_within, all_past_ctl, packed_past_ctl, I, C, B, IB, CB, F, G, R, T, U, all_F, batched_F, batched_RTU, consistency, consistency_formula, size };
+
+//! @brief Names of the operators measured by the benchmark.
+constexpr char const* bench_op_names[] = {"none", "Y", "AY", "EY", "S", "AS", "ES", "P", "AP", "EP", "H", "AH", "EH", "S_within", "AS_within", "ES_within", "P_within", "AP_within", "EP_within", "H_within", "AH_within", "EH_within", "all_past_ctl", "packed_past_ctl", "I", "C", "B", "IB", "CB", "F", "G", "R", "T", "U", "all_F", "batched_F", "batched_RTU", "consistency", "consistency_formula"};
+
+//! @brief Counters accumulated across the rounds of a benchmark run.
+struct bench_counters {
+    //! @brief Number of rounds executed.
+    static std::atomic<size_t> rounds;
+    //! @brief Total size of the messages sent.
+    static std::atomic<size_t> bytes;
+    //! @brief Number of rounds in which batched and scalar operators disagree.
+    static std::atomic<size_t> mismatches;
+};
+std::atomic<size_t> bench_counters::rounds{0};
+std::atomic<size_t> bench_counters::bytes{0};
+std::atomic<size_t> bench_counters::mismatches{0};
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Tags used in the node storage and network initialisation.
+namespace tags {
+    //! @brief Operator measured.
+    struct operator_id {};
+    //! @brief Result of the operator measured.
+    struct result {};
+    //! @brief Number of nodes in the network.
+    struct node_count {};
+    //! @brief Side of the square area containing the network.
+    struct side {};
+}
+
+//! @brief The 12 elementary Past-CTL operators of f (or f1 and f2), packed in the lowest bits.
+constexpr packed_formulas all_past_ctl_formulas = {
+    0b111111111000, // since: all but the yesterday operators
+    0b010010010010, // all: AY, AS, AP, AH
+    0b100100100100, // any: EY, ES, EP, EH
+    0b111000000010  // init: AY, H, AH, EH
+};
+
+//! @brief Whether an odd number of bits is set in a word (portable across compilers).
+inline bool parity(uint64_t x) {
+    for (size_t shift = 32; shift > 0; shift /= 2)
+        x ^= x >> shift;
+    return x & 1;
+}
+
+//! @brief Evaluates the operator selected in the node storage on random propositions.
+FUN void bench_program(ARGS) { CODE
+    using namespace logic;
+    using namespace tags;
+
+    node.storage(group{}) = node.uid / bench_group_size;
+    node.storage(leader{}) = node.uid - node.uid % bench_group_size;
+    bool f1 = node.next_real() < 0.5;
+    bool f2 = node.next_real() < 0.1;
+    bool r = false;
+    switch (bench_op(node.storage(operator_id{}))) {
+        case bench_op::Y:  r = Y(CALL, f1); break;
+        case bench_op::AY: r = AY(CALL, f1); break;
+        case bench_op::EY: r = EY(CALL, f1); break;
+        case bench_op::S:  r = S(CALL, f1, f2); break;
+        case bench_op::AS: r = AS(CALL, f1, f2); break;
+        case bench_op::ES: r = ES(CALL, f1, f2); break;
+        case bench_op::P:  r = P(CALL, f1); break;
+        case bench_op::AP: r = AP(CALL, f1); break;
+        case bench_op::EP: r = EP(CALL, f1); break;
+        case bench_op::H:  r = H(CALL, f1); break;
+        case bench_op::AH: r = AH(CALL, f1); break;
+        case bench_op::EH: r = EH(CALL, f1); break;
+        case bench_op::S_within:  r = S_within(CALL, f1, f2, bench_within); break;
+        case bench_op::AS_within: r = AS_within(CALL, f1, f2, bench_within); break;
+        case bench_op::ES_within: r = ES_within(CALL, f1, f2, bench_within); break;
+        case bench_op::P_within:  r = P_within(CALL, f2, bench_within); break;
+        case bench_op::AP_within: r = AP_within(CALL, f2, bench_within); break;
+        case bench_op::EP_within: r = EP_within(CALL, f2, bench_within); break;
+        case bench_op::H_within:  r = H_within(CALL, f1, bench_within); break;
+        case bench_op::AH_within: r = AH_within(CALL, f1, bench_within); break;
+        case bench_op::EH_within: r = EH_within(CALL, f1, bench_within); break;
+        case bench_op::all_past_ctl:
+            r = Y(CALL, f1) ^ AY(CALL, f1) ^ EY(CALL, f1) ^ S(CALL, f1, f2) ^ AS(CALL, f1, f2) ^ ES(CALL, f1, f2)
+              ^ P(CALL, f1) ^ AP(CALL, f1) ^ EP(CALL, f1) ^ H(CALL, f1) ^ AH(CALL, f1) ^ EH(CALL, f1);
+            break;
+        case bench_op::packed_past_ctl: {
+            formula_mask m1 = f1 ? ~formula_mask(0) : 0, m2 = f2 ? ~formula_mask(0) : 0;
+            // arguments of the yesterday, since, previously and historically operators
+            formula_mask a1 = (m1 & 0b111000111000) | 0b000111000000;
+            formula_mask a2 = (m1 & 0b000111000111) | (m2 & 0b000000111000);
+            formula_mask p = logic::packed(CALL, a1, a2, all_past_ctl_formulas);
+            r = parity(p & 0b111111111111);
+            break;
+        }
+        case bench_op::I:  r = I(CALL, f1); break;
+        case bench_op::C:  r = C(CALL, f1); break;
+        case bench_op::B:  r = B(CALL, f1); break;
+        case bench_op::IB: r = IB(CALL, f1); break;
+        case bench_op::CB: r = CB(CALL, f1); break;
+        case bench_op::F:  r = F(CALL, f2); break;
+        case bench_op::G:  r = G(CALL, f1); break;
+        case bench_op::R:  r = R(CALL, f1, f2); break;
+        case bench_op::T:  r = T(CALL, f1, f2); break;
+        case bench_op::U:  r = U(CALL, f1, f2); break;
+        case bench_op::all_F:
+            r = F(CALL, f2) ^ F(CALL, f1 & f2) ^ F(CALL, f1 < f2) ^ F(CALL, f1 > f2);
+            break;
+        case bench_op::batched_F: {
+            std::vector<bool> v = F(CALL, std::vector<bool>{f2, f1 & f2, f1 < f2, f1 > f2});
+            r = v[0] ^ v[1] ^ v[2] ^ v[3];
+            break;
+        }
+        case bench_op::batched_RTU: {
+            // batched operators checked against the scalar ones on the same regions
+            // (every scalar call in its own call site, so that they are not aligned together)
+            std::vector<bool> v1{f1, f2, !f1}, v2{f2, f1, f1 & f2};
+            std::vector<bool> vr = R(CALL, v1, v2), vt = T(CALL, v1, v2), vu = U(CALL, v1, v2);
+            std::vector<bool> sr{R(CALL, f1, f2), R(CALL, f2, f1), R(CALL, !f1, f1 & f2)};
+            std::vector<bool> st{T(CALL, f1, f2), T(CALL, f2, f1), T(CALL, !f1, f1 & f2)};
+            std::vector<bool> su{U(CALL, f1, f2), U(CALL, f2, f1), U(CALL, !f1, f1 & f2)};
+            if (sr != vr or st != vt or su != vu) ++bench_counters::mismatches;
+            for (size_t i = 0; i < v1.size(); ++i)
+                r ^= vr[i] ^ vt[i] ^ vu[i];
+            break;
+        }
+        case bench_op::consistency: {
+            bool warning = count_within(CALL, 0.25*communication_range) > 5;
+            bool cluster = count_where(CALL, nbr(CALL, warning)) >= 3;
+            r = consistency_monitor(CALL, cluster);
+            break;
+        }
+        case bench_op::consistency_formula: {
+            bool warning = count_within(CALL, 0.25*communication_range) > 5;
+            bool cluster = count_where(CALL, nbr(CALL, warning)) >= 3;
+            r = split(CALL, node.storage(group{}), [&](){
+                return formula::evaluate(CALL, consistency_formula, warning, cluster);
+            });
+            break;
+        }
+        default:
+            break;
+    }
+    node.storage(result{}) = r;
+    ++bench_counters::rounds;
+    bench_counters::bytes += node.msg_size();
+}
+//! @brief Export types used by the bench_program function.
+FUN_EXPORT bench_program_t = export_list<past_ctl_t, slcs_t, monitor_t, formula::exports<decltype(consistency_formula)>, int>;
+
+//! @brief Main struct calling the benchmark program.
+struct bench_main {
+    //! @brief The main function.
+    template <typename node_t>
+    void operator()(node_t& node, times_t) {
+        bench_program(CALL);
+    }
+};
+
+} // namespace coordination
+
+//! @brief Namespace for component options.
+namespace option {
+
+//! @brief Import tags to be used for component options.
+using namespace component::tags;
+//! @brief Import tags used by aggregate functions.
+using namespace coordination::tags;
+
+//! @brief Description of the round schedule (one round every second, with random start).
+using bench_round_s = sequence::periodic<
+    distribution::interval_n<times_t, 0, 1>,
+    distribution::constant_n<times_t, 1>,
+    distribution::constant_n<times_t, bench_time>
+>;
+//! @brief All nodes are spawned at the start, in groups of consecutive identifiers.
+using bench_spawn_s = sequence::multiple<distribution::constant_i<size_t, node_count>, distribution::constant_n<times_t, 0>>;
+//! @brief Nodes are randomly displaced in a square area.
+using bench_rectangle_d = distribution::rect<
+    distribution::constant_n<real_t, 0>, distribution::constant_n<real_t, 0>,
+    distribution::constant_i<real_t, side>, distribution::constant_i<real_t, side>
+>;
+
+//! @brief The contents of the node storage as tags and associated types, given the template holding them.
+template <template <typename...> class T>
+using bench_store_of = T<
+    operator_id,   int,
+    result,        bool,
+    group,         group_t,
+    leader,        device_t,
+    flight_record, flight_record_t // staged by the consistency monitor
+>;
+
+//! @brief The benchmark options.
+DECLARE_OPTIONS(bench_list,
+    parallel<false>,     // rounds are measured in a single thread
+    synchronised<false>, // optimise for asynchronous networks
+    message_size<true>,  // emulate the size of messages
+    program<coordination::bench_main>,      // program to be run
+    exports<coordination::bench_program_t>, // export type list (types used in messages)
+    retain<metric::retain<3,1>>,            // messages are kept for 3 seconds before expiring
+    round_schedule<bench_round_s>,          // the sequence generator for round events on nodes
+    spawn_schedule<bench_spawn_s>,          // the sequence generator of node creation events
+    init<
+        x,           bench_rectangle_d,
+        operator_id, distribution::constant_i<int, operator_id>
+    >,
+    bench_store_of<tuple_store>,            // the contents of the node storage
+    connector<connect::fixed<communication_range>> // connection allowed within a fixed comm range
+);
+
+} // namespace option
+
+//! @brief The size in bytes of the storage of every node.
+constexpr size_t bench_store_size = sizeof(option::bench_store_of<common::tagged_tuple_t>);
+
+} // namespace fcpp
+
+
+//! @brief The main function.
+int main() {
+    using namespace fcpp;
+
+    //! @brief Stream discarding the simulation output.
+    std::ofstream discard;
+
+    //! @brief The network object type (batch simulator with benchmark options).
+    using net_t = component::batch_simulator<option::bench_list>::net;
+    std::printf("%-16s %8s %8s %14s %14s %14s\n", "operator", "nodes", "degree", "rounds/s", "bytes/round", "bytes/node");
+    // the footprint of a node is its storage together with its export (as sent in a round)
+    for (size_t n : {100, 1000, 10000, 100000})
+        for (double degree : {10.0, 40.0}) {
+            // side of the area yielding the given average number of neighbours
+            double side = std::sqrt(n * std::acos(-1) * communication_range * communication_range / degree);
+            for (int op = 0; op < int(bench_op::size); ++op) {
+                bench_counters::rounds = 0;
+                bench_counters::bytes = 0;
+                bench_counters::mismatches = 0;
+                auto init_v = common::make_tagged_tuple<option::node_count, option::side, option::operator_id, option::output>(n, side, op, &discard);
+                auto start = std::chrono::steady_clock::now();
+                {
+                    net_t network{init_v};
+                    network.run();
+                }
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                size_t rounds = bench_counters::rounds;
+                double bytes = bench_counters::bytes / double(rounds);
+                std::printf("%-16s %8zu %8.0f %14.0f %14.1f %14.1f\n", bench_op_names[op], n, degree, rounds / elapsed, bytes, bench_store_size + bytes);
+                if (bench_counters::mismatches > 0)
+                    std::fprintf(stderr, "%s: batched and scalar operators disagree in %zu rounds\n", bench_op_names[op], size_t(bench_counters::mismatches));
+                std::fflush(stdout);
+            }
+        }
+    return 0;
+}